@@ -0,0 +1,263 @@
+#include "amdmsrt.h"
+#include "mumu.h"
+#include "msr.h"
+#include "cores.h"
+#include "snapshot.h"
+#include "pstate.h"
+#include "apply.h"
+#include "codec.h"
+#include "boost.h"
+#include "simcpu.h"
+#include "thermal.h"
+
+#include <string.h> //memset
+#include <algorithm> //std::max
+#include <exception>
+
+static_assert(AMDMSRT_NUMPSTATES == NUMPSTATES, "amdmsrt.h and mumu.h disagree on the number of P-states");
+static_assert(AMDMSRT_MAXCORES == MAXCPUCORES, "amdmsrt.h and cores.h disagree on the max. number of cores");
+
+static bool opened=false;
+
+//the layers below throw on bad arguments(checked before calling them anyway) and std::thread on running out of threads; none of that gets out of the library
+template <typename F> static int Guarded(F fn) {
+  if (!opened) {
+    return AMDMSRT_ENOTOPEN;
+  }
+  try {
+    return fn();
+  } catch (const std::exception&) {
+    return AMDMSRT_EINTERNAL;
+  } catch (...) {
+    return AMDMSRT_EINTERNAL;
+  }
+}
+
+static bool IsOnline(const int cpu) {
+  return -1 != CoreIndexOfCpu(cpu);
+}
+
+int amdmsrt_open(const unsigned int flags) {
+  if (opened) {
+    return AMDMSRT_OK;
+  }
+  if (0 != (flags & AMDMSRT_OPEN_SIM)) {
+    SimActivate();
+  } else if (!SelectCodecFromCpuid()) {
+    return AMDMSRT_EUNSUPPORTED;//the tool falls back to decoding as 12h, a library caller gets to decide that
+  }
+  if (DiscoverTopology() <= 0) {
+    return AMDMSRT_ENOCPUS;
+  }
+  if (!MsrOpenAll()) {
+    MsrCloseAll();
+    return AMDMSRT_EACCESS;
+  }
+  opened=true;
+  return AMDMSRT_OK;
+}
+
+void amdmsrt_close(void) {
+  MsrCloseAll();
+  //undo what SimActivate() or SelectCodecFromCpuid() set up, so the next amdmsrt_open() starts from scratch(eg. a real cpu after the simulated one)
+  SetMsrBackend(NULL);
+  SetSimulatedTopology(0);
+  SetTemperatureSource(NULL, NULL);
+  ResetNumBoostStates();
+  SelectCodec(CPUFAMILY, CPUMODEL);//the default, see Codec()
+  opened=false;
+}
+
+const char* amdmsrt_strerror(const int status) {
+  switch (status) {
+    case AMDMSRT_OK: return "ok";
+    case AMDMSRT_ENOTOPEN: return "not open";
+    case AMDMSRT_EUNSUPPORTED: return "unsupported cpu";
+    case AMDMSRT_ENOCPUS: return "no online cpus found";
+    case AMDMSRT_EACCESS: return "can't open the msr devices(not root, or no msr module)";
+    case AMDMSRT_EINVAL: return "invalid argument";
+    case AMDMSRT_EMSR: return "msr access failed";
+    case AMDMSRT_ETIMEOUT: return "P-state transition timed out";
+    case AMDMSRT_EROLLEDBACK: return "apply failed and was rolled back";
+    case AMDMSRT_EINTERNAL: return "internal error";
+    default: return "unknown error";
+  }
+}
+
+int amdmsrt_num_cores(void) {
+  return (opened ? NumCores() : 0);
+}
+
+int amdmsrt_core_cpu(const int idx) {
+  return ((opened && (idx >= 0) && (idx < NumCores())) ? Core(idx).cpu : -1);
+}
+
+int amdmsrt_num_boost_states(void) {
+  return NumBoostStates();
+}
+
+const char* amdmsrt_codec_name(void) {
+  return Codec().name;
+}
+
+int amdmsrt_snapshot(struct amdmsrt_snapshot* snap) {
+  if (NULL == snap) {
+    return AMDMSRT_EINVAL;
+  }
+  return Guarded([snap]() {
+      PStateSnapshot s;
+      const bool ok=TakeSnapshot(s);
+      memset(snap, 0, sizeof(*snap));
+      snap->numcores=s.numcores;
+      for (int i = 0; i < s.numcores; i++) {
+        amdmsrt_core_state& c=snap->core[i];
+        c.cpu=s.cpu[i];
+        c.ok=(s.ok[i] ? 1 : 0);
+        c.running=GetBits(s.cofvidstatus[i], 16, 3);
+        c.acknowledged=SwToHw(GetBits(s.pstatestatus[i], 0, 3));
+        for (int p = 0; p < NUMPSTATES; p++) {
+          c.def[p]=s.pstatedef[p][i];
+          c.decoded[p].multi=Codec().multi(s.pstatedef[p][i]);
+          c.decoded[p].voltage=Codec().voltage(Codec().vid(s.pstatedef[p][i]));
+        }
+      }
+      return (ok ? AMDMSRT_OK : AMDMSRT_EMSR);
+      });
+}
+
+//a caller's table, checked and encoded at runtime the way profile.h does allpsi at compile time(EncodePState() and FirstBadPStateRow())
+static bool EncodeTable(const amdmsrt_pstate* table, PStateWord* words) {
+  for (int p = 0; p < NUMPSTATES; p++) {
+    if ((table[p].multi < CPUMINMULTIunderclocked) || (table[p].multi > CPUMAXMULTIunderclocked)
+        || (table[p].voltage < CPUMINVOLTAGEunderclocked) || (table[p].voltage > V1325)) {
+      return false;
+    }
+    if ((p > 0) && ((table[p].multi > table[p-1].multi) || (table[p].voltage > table[p-1].voltage))) {
+      return false;//P0 must be the fastest and highest voltage one
+    }
+    const int vid=Codec().voltage2vid(table[p].voltage);
+    uint64_t bits=0;
+    if (!Codec().encode(table[p].multi, vid, bits)) {
+      return false;
+    }
+    const double diff=Codec().voltage(vid) - table[p].voltage;
+    if ((diff > 1e-6) || (diff < -1e-6)) {
+      return false;//between two VIDs
+    }
+    words[p]={ 0, 0, vid, bits, true };//fid/did are only kept for the compile time profiles, apply uses lo
+  }
+  return true;
+}
+
+int amdmsrt_apply_profile(const struct amdmsrt_pstate* table, struct amdmsrt_apply_result* result) {
+  return Guarded([table, result]() {
+      PStateWord words[NUMPSTATES];
+      if ((NULL != table) && !EncodeTable(table, words)) {
+        return (int)AMDMSRT_EINVAL;
+      }
+      if ((NULL == table) && (CPUFAMILY != Codec().family)) {
+        return (int)AMDMSRT_EUNSUPPORTED;
+      }
+      ApplySummary summary;
+      const bool ok=(NULL == table ? ApplyCoreProfiles(summary) : ApplyProfile(words, summary));
+      if (NULL != result) {
+        result->cores=summary.cores;
+        result->differing=summary.differing;
+        result->written=summary.written;
+        result->switched=summary.switched;
+        result->errors=summary.errors;
+        result->rolledback=(summary.rolledback ? 1 : 0);
+      }
+      if (ok) {
+        return (int)AMDMSRT_OK;
+      }
+      return (int)(summary.rolledback ? AMDMSRT_EROLLEDBACK : AMDMSRT_EMSR);
+      });
+}
+
+static int LatencyStatus(const int64_t latency) {
+  return (latency >= 0 ? AMDMSRT_OK : (-2 == latency ? AMDMSRT_ETIMEOUT : AMDMSRT_EMSR));
+}
+
+int amdmsrt_set_pstate(const int cpu, const int pstate, int64_t* latencyns) {
+  if ((pstate < 0) || (pstate >= NUMPSTATES)) {
+    return AMDMSRT_EINVAL;
+  }
+  return Guarded([cpu, pstate, latencyns]() {
+      if (-1 != cpu) {
+        if (!IsOnline(cpu)) {
+          return (int)AMDMSRT_EINVAL;
+        }
+        const int64_t latency=SetCorePState(cpu, pstate);
+        if (NULL != latencyns) {
+          *latencyns=latency;
+        }
+        return LatencyStatus(latency);
+      }
+      int64_t latency[MAXCPUCORES];
+      RunOnEachCore([pstate, &latency](int i) {
+          latency[i]=SetCorePState(Core(i).cpu, pstate);
+          });
+      int status=AMDMSRT_OK;
+      int64_t maxlatency=0;
+      for (int i = 0; i < NumCores(); i++) {
+        if (latency[i] < 0) {
+          status=(AMDMSRT_OK == status ? LatencyStatus(latency[i]) : status);
+        } else {
+          maxlatency=std::max(maxlatency, latency[i]);
+        }
+      }
+      if (NULL != latencyns) {
+        *latencyns=maxlatency;
+      }
+      return status;
+      });
+}
+
+int amdmsrt_get_pstate(const int cpu, int* running) {
+  if (NULL == running) {
+    return AMDMSRT_EINVAL;
+  }
+  return Guarded([cpu, running]() {
+      if (!IsOnline(cpu)) {
+        return (int)AMDMSRT_EINVAL;
+      }
+      *running=GetCorePState(cpu);
+      return (int)(-1 == *running ? AMDMSRT_EMSR : AMDMSRT_OK);
+      });
+}
+
+int amdmsrt_get_limit(const int cpu, int* curlimit, int* maxval) {
+  if ((NULL == curlimit) || (NULL == maxval)) {
+    return AMDMSRT_EINVAL;
+  }
+  return Guarded([cpu, curlimit, maxval]() {
+      if (!IsOnline(cpu)) {
+        return (int)AMDMSRT_EINVAL;
+      }
+      return (int)(GetCorePStateLimit(cpu, *curlimit, *maxval) ? AMDMSRT_OK : AMDMSRT_EMSR);
+      });
+}
+
+int amdmsrt_set_limit(const int cpu, const int fastest) {
+  if ((fastest < 0) || (fastest >= NUMPSTATES)) {
+    return AMDMSRT_EINVAL;
+  }
+  return Guarded([cpu, fastest]() {
+      if ((-1 != cpu) && !IsOnline(cpu)) {
+        return (int)AMDMSRT_EINVAL;
+      }
+      for (int i = 0; i < NumCores(); i++) {
+        if ((-1 == cpu) || (Core(i).cpu == cpu)) {
+          SetCorePStateCap(Core(i).cpu, fastest);
+        }
+      }
+      return (int)AMDMSRT_OK;
+      });
+}
+
+int amdmsrt_set_boost(const int enabled) {
+  return Guarded([enabled]() {
+      return (int)(0 == SetCpb(0 != enabled) ? AMDMSRT_OK : AMDMSRT_EMSR);
+      });
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+//libamdmsrt: the register layer, the per-family codecs, snapshots and the transactional apply of amdmsrt4myZ575 as a library, for switching P-states in-process(eg. a job runner around a latency critical phase) instead of running the tool
+//link with libamdmsrt.a(plus -lstdc++ -lm -pthread when linking with a C compiler) or libamdmsrt.so; like the tool it needs root(or CAP_SYS_RAWIO) and the msr module
+//nothing here throws or prints(the tool's messages are printed by its modes, none of which are in the library): every call returns AMDMSRT_OK or one of the negative amdmsrt_status values, see amdmsrt_strerror()
+//P-states use hardware numbering, 0..7 as in 0xc0010064+N; the boost states come first(see amdmsrt_num_boost_states()) and can only be reached by requesting P0 with boost enabled
+//amdmsrt_open()/amdmsrt_close() are not thread safe, everything in between can be called from any thread(also concurrently; two threads requesting different P-states for the same cpu just race, the last request wins)
+//this header is usable from C too, the library itself is C++
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum {
+  AMDMSRT_NUMPSTATES = 8,
+  AMDMSRT_MAXCORES = 64
+};
+
+enum amdmsrt_status {
+  AMDMSRT_OK = 0,
+  AMDMSRT_ENOTOPEN = -1, //amdmsrt_open() wasn't called or failed
+  AMDMSRT_EUNSUPPORTED = -2, //not an AMD cpu family this knows, or the built-in profiles on a cpu they aren't for
+  AMDMSRT_ENOCPUS = -3, //no online cpus found in sysfs
+  AMDMSRT_EACCESS = -4, //opening /dev/cpu/N/msr failed: not root, or the msr module isn't loaded
+  AMDMSRT_EINVAL = -5, //a cpu that isn't online, a P-state out of range, or a table the codec can't encode
+  AMDMSRT_EMSR = -6, //a register read or write failed
+  AMDMSRT_ETIMEOUT = -7, //a core didn't report the requested P-state in time
+  AMDMSRT_EROLLEDBACK = -8, //an apply failed part way, every register it wrote was restored
+  AMDMSRT_EINTERNAL = -9 //out of memory or threads
+};
+
+//flags for amdmsrt_open()
+enum {
+  AMDMSRT_OPEN_SIM = 1 //the simulated family 12h cpu instead of /dev/cpu/N/msr, nothing real is touched
+};
+
+//picks the codec from CPUID, discovers the online cores and opens their msr devices
+int amdmsrt_open(const unsigned int flags);
+void amdmsrt_close(void);
+const char* amdmsrt_strerror(const int status);
+
+//valid while open
+int amdmsrt_num_cores(void);
+int amdmsrt_core_cpu(const int idx);//logical cpu number of core index idx(0..amdmsrt_num_cores()-1), -1 if out of range
+int amdmsrt_num_boost_states(void);
+const char* amdmsrt_codec_name(void);//eg. "12h"
+
+struct amdmsrt_pstate {
+  double multi; //times the 100MHz reference clock
+  double voltage;
+};
+
+struct amdmsrt_core_state {
+  int cpu;
+  int ok; //0 if any read failed, the rest of this core's values are then 0
+  int running; //from COFVID
+  int acknowledged; //from the P-state status register
+  uint64_t def[AMDMSRT_NUMPSTATES]; //the raw definition registers
+  struct amdmsrt_pstate decoded[AMDMSRT_NUMPSTATES];
+};
+
+struct amdmsrt_snapshot {
+  int numcores;
+  struct amdmsrt_core_state core[AMDMSRT_MAXCORES]; //indexed like amdmsrt_core_cpu()
+};
+
+//all cores in one parallel pass; AMDMSRT_EMSR if any core couldn't be read(the others are still filled in)
+int amdmsrt_snapshot(struct amdmsrt_snapshot* snap);
+
+struct amdmsrt_apply_result {
+  int cores;
+  int differing; //definition registers(over all cores) that differed from the table
+  int written; //and were written and verified
+  int switched; //cores bounced through another P-state because the one they ran in was rewritten
+  int errors;
+  int rolledback;
+};
+
+//writes table[0..AMDMSRT_NUMPSTATES-1] to every core's P-state definitions, only the registers that differ, verified and rolled back on any failure
+//table NULL applies the built-in profiles(allpsi, per core), which are only for the family 12h cpu they were tuned on
+//every row must be exactly encodable by this cpu's codec, 8x..30x and 0.7125V..1.325V(the Z575's bounds, as for allpsi), and no faster or higher voltage than the row before it
+//AMDMSRT_EINVAL otherwise, with nothing written; result can be NULL
+int amdmsrt_apply_profile(const struct amdmsrt_pstate* table, struct amdmsrt_apply_result* result);
+
+//requests pstate on that cpu(-1 is all cores, in parallel) and waits until it's acknowledged; clamped to the cpu's limit(see amdmsrt_set_limit()) and the hardware's
+//latencyns(can be NULL) gets the write-to-acknowledge time, the slowest core's for -1
+int amdmsrt_set_pstate(const int cpu, const int pstate, int64_t* latencyns);
+int amdmsrt_get_pstate(const int cpu, int* running);
+//the hardware limit(0xc0010061 is read-only): the fastest P-state allowed right now, eg. lower when hot, and the slowest there is
+int amdmsrt_get_limit(const int cpu, int* curlimit, int* maxval);
+//the limit in software instead: from now on amdmsrt_set_pstate() keeps that cpu(-1 is all cores) at fastest or slower, 0 removes it; the current P-state isn't changed
+int amdmsrt_set_limit(const int cpu, const int fastest);
+//Core Performance Boost on all cores
+int amdmsrt_set_boost(const int enabled);
+
+#ifdef __cplusplus
+}
+#endif
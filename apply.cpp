@@ -0,0 +1,157 @@
+#include "apply.h"
+#include "mumu.h"
+#include "msr.h"
+#include "pstate.h"
+#include "snapshot.h"
+#include "telemetry.h"
+#include "codec.h"
+#include "boost.h"
+
+#include <string.h> //memset
+
+bool IsProfileCpu() {
+  unsigned int family=0, model=0;
+  return CpuidFamilyModel(family, model) && (CPUFAMILY == family) && (CPUMODEL == model);
+}
+
+//the definition register of the P-state this core is running in right now, hardware numbering(same as the 0xc0010064+N index), -1 if unreadable
+static int ActivePStateDef(const int cpu) {
+  uint64_t cofvid;
+  if (!MsrRead(cpu, MSRCOFVIDSTATUS, cofvid)) {
+    return -1;
+  }
+  return GetBits(cofvid, 16, 3);
+}
+
+//switch to another pstate temporarily, then back again, so the current one takes the new values
+static bool BounceCore(const int cpu, const int hwpstate) {
+  const int current=HwToSw(hwpstate);//a boosting core goes back up into boost from software P0, taking the new boost definition
+  const int last=HwToSw(NUMPSTATES - 1);//the slowest one
+  const int temp=(current == last ? 0 : last);
+  return (SwitchCorePState(cpu, temp, PSTATETRANSITIONTIMEOUTNS) >= 0) && (SwitchCorePState(cpu, current, PSTATETRANSITIONTIMEOUTNS) >= 0);
+}
+
+//words[i] is what core index i(as in the snapshot) gets
+static bool DiffWriteVerify(const PStateWord* const* words, ApplySummary& summary) {
+  memset(&summary, 0, sizeof(summary));
+  PStateSnapshot before;
+  const bool snapok=TakeSnapshot(before);
+  summary.cores=before.numcores;
+  if (!snapok) {
+    //nothing to roll back to for the cores that couldn't be read, so don't touch any core
+    for (int i = 0; i < before.numcores; i++) {
+      summary.errors += (before.ok[i] ? 0 : 1);
+    }
+    return false;
+  }
+
+  //the plan: which registers differ on which core, and what goes into them
+  uint64_t wanted[NUMPSTATES][MAXCPUCORES];
+  uint32_t differs[MAXCPUCORES]={0};
+  for (int i = 0; i < before.numcores; i++) {
+    for (int p = 0; p < NUMPSTATES; p++) {
+      wanted[p][i]=(before.pstatedef[p][i] & ~Codec().mask) | words[i][p].lo;
+      if (wanted[p][i] != before.pstatedef[p][i]) {
+        differs[i] |= (1u << p);
+        summary.differing++;
+      }
+    }
+  }
+  if (0 == summary.differing) {
+    return true;
+  }
+
+  //write + verify, each core from its own pinned thread
+  uint32_t touched[MAXCPUCORES]={0};//attempted writes, these are what a rollback restores
+  int failed[MAXCPUCORES]={0};
+  RunOnEachCore([&](int i) {
+      const int cpu=before.cpu[i];
+      for (int p = 0; p < NUMPSTATES; p++) {
+        if (0 == (differs[i] & (1u << p))) {
+          continue;
+        }
+        touched[i] |= (1u << p);
+        uint64_t readback=0;
+        if (!MsrWrite(cpu, MSRPSTATEDEF0 + p, wanted[p][i]) || !MsrRead(cpu, MSRPSTATEDEF0 + p, readback) || (readback != wanted[p][i])) {
+          failed[i]++;
+          return;//no point in going on, everything gets rolled back anyway
+        }
+      }
+      });
+
+  for (int i = 0; i < before.numcores; i++) {
+    summary.errors += failed[i];
+  }
+
+  if (0 != summary.errors) {
+    //restore all cores, not just the failed one, so they don't end up with different definitions.
+    //nothing was switched yet, so the running P-states never used the new values
+    int rollbackfailed[MAXCPUCORES]={0};
+    RunOnEachCore([&](int i) {
+        const int cpu=before.cpu[i];
+        for (int p = 0; p < NUMPSTATES; p++) {
+          if (0 == (touched[i] & (1u << p))) {
+            continue;
+          }
+          uint64_t readback=0;
+          if (!MsrWrite(cpu, MSRPSTATEDEF0 + p, before.pstatedef[p][i]) || !MsrRead(cpu, MSRPSTATEDEF0 + p, readback) || (readback != before.pstatedef[p][i])) {
+            rollbackfailed[i]++;
+          }
+        }
+        });
+    for (int i = 0; i < before.numcores; i++) {
+      summary.errors += rollbackfailed[i];
+    }
+    summary.rolledback=true;
+    return false;
+  }
+
+  //everything verified: bounce only the cores whose current P-state's definition changed, a core in any other P-state picks up the new values on its next transition anyway
+  bool switched[MAXCPUCORES]={false};
+  int switchfailed[MAXCPUCORES]={0};
+  RunOnEachCore([&](int i) {
+      const int cpu=before.cpu[i];
+      const int active=ActivePStateDef(cpu);
+      if (-1 == active) {
+        switchfailed[i]++;
+        return;
+      }
+      if (0 == (touched[i] & (1u << active))) {
+        return;
+      }
+      switched[i]=true;
+      if (!BounceCore(cpu, active)) {
+        switchfailed[i]++;
+      }
+      });
+
+  for (int i = 0; i < before.numcores; i++) {
+    summary.writtenmask[i]=touched[i];
+    summary.written += __builtin_popcount(touched[i]);
+    summary.switched += (switched[i] ? 1 : 0);
+    summary.errors += switchfailed[i];
+  }
+  return (0 == summary.errors);
+}
+
+static bool ApplyWords(const PStateWord* const* words, ApplySummary& summary) {
+  const bool ok=DiffWriteVerify(words, summary);
+  TelemetryApply(summary.cores, summary.differing, summary.written, summary.switched, summary.errors, summary.rolledback);
+  return ok;
+}
+
+bool ApplyProfile(const PStateWord* words, ApplySummary& summary) {
+  const PStateWord* percore[MAXCPUCORES];
+  for (int i = 0; i < MAXCPUCORES; i++) {
+    percore[i]=words;
+  }
+  return ApplyWords(percore, summary);
+}
+
+bool ApplyCoreProfiles(ApplySummary& summary) {
+  const PStateWord* percore[MAXCPUCORES];
+  for (int i = 0; i < NumCores(); i++) {
+    percore[i]=ProfileOfCpu(Core(i).cpu).words;
+  }
+  return ApplyWords(percore, summary);
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "profile.h"
+#include "cores.h"
+
+struct ApplySummary {
+  int cores; //cores looked at
+  int differing; //P-state definition registers(over all cores) that differed from the profile
+  int written; //of those, registers written and read back with the wanted value
+  int switched; //cores bounced through another P-state because the definition of the one they were running in changed
+  int errors; //failed msr accesses, readbacks or transitions
+  bool rolledback; //a write or readback failed, so every register written was restored from the snapshot taken before
+  uint32_t writtenmask[MAXCPUCORES]; //per core(indexed like Core()): bit p set if P-state p's definition was written(and not rolled back)
+};
+
+//transactional apply, no printing:
+//1. snapshot all cores(see snapshot.h), diff every P-state definition's fid, did and vid(the bits Codec().mask covers, see codec.h) against words[]
+//2. write only the registers that differ, read each one back to verify
+//3. if any write or readback failed on any core: restore every register written, on all cores, to the snapshot value
+//4. otherwise switch to another P-state and back only those cores whose current P-state's definition was written
+//returns true if everything was written and verified(or nothing differed)
+bool ApplyProfile(const PStateWord* words, ApplySummary& summary);
+//the same, but each core gets its own profile, see ProfileOfCpu() in profile.h
+bool ApplyCoreProfiles(ApplySummary& summary);
+
+//true if this is the family/model the profiles are for(CPUFAMILY/CPUMODEL in mumu.h) on an AuthenticAMD cpu
+bool IsProfileCpu();
@@ -0,0 +1,165 @@
+#include "bench.h"
+#include "mumu.h"
+#include "codec.h"
+#include "pstate.h"
+#include "boost.h"
+#include "cores.h"
+#include "options.h"
+#include "timing.h"
+
+#include <stdio.h>
+#include <stdlib.h> //aligned_alloc strtol
+#include <algorithm> //std::min
+#include <atomic>
+
+struct BenchKernel {
+  const char* name;
+  KernelFn fn;
+  size_t bytes;
+  int rounds;
+  const char* unit;
+  double perround; //units per round: elements, bytes moved or loads
+  bool latency; //report ns per unit instead of units per second
+};
+
+static const BenchKernel benchkernels[]={
+  {"int-hash", KernelInt,    KERNELL1BYTES,  1024, "Melem/s", KERNELL1BYTES / 8.0,       false},
+  {"fp-simd",  KernelFp,     KERNELL1BYTES,  4096, "Melem/s", KERNELL1BYTES / 8.0,       false},
+  {"mem-bw",   KernelStream, KERNELRAMBYTES, 4,    "MB/s",    KERNELRAMBYTES * 3.0,      false},//2 reads + 1 write per element
+  {"mem-lat",  KernelChase,  KERNELRAMBYTES, 2,    "ns/load", KERNELRAMBYTES / 64.0,     true},
+};
+#define NUMBENCHKERNELS (int)(sizeof(benchkernels) / sizeof(benchkernels[0]))
+
+int64_t TimeKernel(KernelFn fn, void* buf, const size_t bytes, const int rounds, const int reps) {
+  int64_t best=INT64_MAX;
+  int64_t bestsetup=INT64_MAX;
+  for (int r = 0; r < reps; r++) {
+    int64_t t=NowNs();
+    fn(buf, bytes, 0);
+    bestsetup=std::min(bestsetup, NowNs() - t);
+    t=NowNs();
+    fn(buf, bytes, rounds);
+    best=std::min(best, NowNs() - t);
+  }
+  return std::max((int64_t)1, best - bestsetup);
+}
+
+//throughput(or latency) of one kernel run, from its time
+static double BenchValue(const BenchKernel& k, const int64_t ns) {
+  const double units=k.perround * k.rounds;
+  if (k.latency) {
+    return ns / units;
+  }
+  return units / (ns / 1e9) / 1e6;//millions per second
+}
+
+int RunBench(const int argc, const char* argv[]) {
+  const int reps=OptInt(argc, argv, "--reps", 5);
+  const char* out=OptValue(argc, argv, "--out");
+  if (NULL == out) {
+    out="bench.csv";
+  }
+  int pstates[NUMPSTATES];
+  int numpstates=0;
+  const char* list=OptValue(argc, argv, "--pstates");
+  if (NULL == list) {
+    for (int p = NumBoostStates(); p < NUMPSTATES; p++) {//boost states can't be requested
+      pstates[numpstates++]=p;
+    }
+  } else {
+    char* end=(char*)list;
+    while (('\0' != *end) && (numpstates < NUMPSTATES)) {
+      pstates[numpstates++]=(int)strtol(end, &end, 10);
+      if (',' == *end) {
+        end++;
+      } else if ('\0' != *end) {
+        break;
+      }
+    }
+  }
+  for (int i = 0; i < numpstates; i++) {
+    if ((pstates[i] < 0) || (pstates[i] >= NUMPSTATES)) {
+      fprintf(stderr, ERRORtext("!! bench: invalid --pstates") "\n");
+      return 2;
+    }
+  }
+  if (reps <= 0) {
+    fprintf(stderr, ERRORtext("!! bench: invalid --reps") "\n");
+    return 2;
+  }
+
+  FILE* csv=fopen(out, "w");
+  if (NULL == csv) {
+    pERR("bench: failed to open the output file");
+    return 3;
+  }
+  fprintf(csv, "pstate,multi,mhz,kernel,mode,cores,value,unit\n");
+
+  const int numcores=NumCores();
+  const int initialpstate=GetCurrentPState();
+  bool cpbwas=false;
+  if (!GetCpb(Core(0).cpu, cpbwas)) {
+    fclose(csv);
+    pERR("bench: failed to read whether boost is enabled");
+    return 3;
+  }
+  int64_t ns[MAXCPUCORES][NUMBENCHKERNELS];
+  std::atomic<bool> oom(false);
+
+  for (int pi = 0; pi < numpstates; pi++) {
+    const int p=pstates[pi];
+    const uint64_t def=Rdmsr(MSRPSTATEDEF0 + p);
+    const double multi=Codec().multi(def);
+    if (!SetCpbForPState(p) || !SetCurrentPState(p)) {
+      fprintf(stderr, ERRORtext("!! bench: failed to switch to P%d, skipping it") "\n", p);
+      continue;
+    }
+
+    for (int allcores = 0; allcores <= 1; allcores++) {
+      RunOnEachCore([&](int i) {
+          if ((0 == allcores) && (0 != i)) {
+            return;//single-core: the others stay idle
+          }
+          void* buf=aligned_alloc(64, KERNELMAXBYTES);
+          if (NULL == buf) {
+            oom.store(true);
+            return;
+          }
+          for (int k = 0; k < NUMBENCHKERNELS; k++) {
+            ns[i][k]=TimeKernel(benchkernels[k].fn, buf, benchkernels[k].bytes, benchkernels[k].rounds, reps);
+          }
+          free(buf);
+          });
+      if (oom.load()) {
+        fclose(csv);
+        SetCpb(cpbwas);
+        SetCurrentPState(initialpstate);
+        fprintf(stderr, ERRORtext("!! bench: out of memory") "\n");
+        return 3;
+      }
+
+      const int cores=(allcores ? numcores : 1);
+      for (int k = 0; k < NUMBENCHKERNELS; k++) {
+        //all-core throughput is the sum over the cores, latency the mean
+        double value=0.0;
+        for (int i = 0; i < cores; i++) {
+          value += BenchValue(benchkernels[k], ns[i][k]);
+        }
+        if (benchkernels[k].latency) {
+          value /= cores;
+        }
+        fprintf(csv, "%d,%.2f,%.0f,%s,%s,%d,%.3f,%s\n", p, multi, multi * DEFAULTREFERENCECLOCK, benchkernels[k].name,
+            (allcores ? "all-core" : "single-core"), cores, value, benchkernels[k].unit);
+        fprintf(stdout, "bench: P%d %5.0fMHz %-9s %-11s %10.1f %s\n", p, multi * DEFAULTREFERENCECLOCK, benchkernels[k].name,
+            (allcores ? "all-core" : "single-core"), value, benchkernels[k].unit);
+      }
+      fflush(csv);
+    }
+  }
+
+  fclose(csv);
+  SetCpb(cpbwas);
+  SetCurrentPState(initialpstate);
+  fprintf(stdout, "bench: table written to %s\n", out);
+  return 0;
+}
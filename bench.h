@@ -0,0 +1,13 @@
+#pragma once
+
+#include "kernels.h"
+
+//per-P-state throughput benchmark: for each P-state, requests it on all cores and runs integer hash, FP/SIMD, memory bandwidth and pointer-chasing latency kernels, on one core and on all cores at once
+//the table goes to a CSV file(machine-readable), a human readable copy to stdout
+//options: --pstates=1,2,3,4,5,6,7 --reps=5 --out=bench.csv
+//returns the process exit code
+int RunBench(const int argc, const char* argv[]);
+
+//runs fn once with rounds and once with 0 rounds(setup only), reps times each, and returns the best time of the actual work in ns
+//(the kernels fill their buffer first, which isn't what we want to measure)
+int64_t TimeKernel(KernelFn fn, void* buf, const size_t bytes, const int rounds, const int reps);
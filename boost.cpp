@@ -0,0 +1,99 @@
+#include "boost.h"
+#include "mumu.h"
+#include "msr.h"
+#include "cores.h"
+#include "telemetry.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <atomic>
+#include <mutex>
+
+#define PCIF4CONFIG "/sys/bus/pci/devices/0000:00:18.4/config" //D18F4
+#define COREPERFBOOSTCONTROL 0x15c //D18F4x15C, NumBoostStates in bits 4:2
+
+//read lazily(only on the first HwToSw() etc.), by whichever thread gets there first: the lock makes that one read, the atomic keeps the lock off the hot path afterwards
+static std::mutex numboostlock;
+static std::atomic<int> numboost{-1};//-1 until read
+static const char* numboostsource="";//guarded by numboostlock
+
+static int ReadNumBoostStates() {
+  const int fd=open(PCIF4CONFIG, O_RDONLY | O_CLOEXEC);
+  if (-1 != fd) {
+    uint32_t reg=0;
+    const bool ok=(sizeof(reg) == pread(fd, &reg, sizeof(reg), COREPERFBOOSTCONTROL));
+    close(fd);
+    if (ok) {
+      numboostsource="D18F4x15C";
+      return GetBits(reg, 2, 3);
+    }
+  }
+  numboostsource="assumed, D18F4x15C unreadable";
+  return 1;
+}
+
+int NumBoostStates() {
+  const int n=numboost.load(std::memory_order_acquire);
+  if (-1 != n) {
+    return n;
+  }
+  std::lock_guard<std::mutex> lock(numboostlock);
+  if (-1 == numboost.load(std::memory_order_relaxed)) {
+    numboost.store(ReadNumBoostStates(), std::memory_order_release);
+  }
+  return numboost.load(std::memory_order_relaxed);
+}
+
+void SetNumBoostStates(const int n, const char* source) {
+  std::lock_guard<std::mutex> lock(numboostlock);
+  numboostsource=source;
+  numboost.store((n < 0 ? 0 : (n >= NUMPSTATES ? NUMPSTATES - 1 : n)), std::memory_order_release);
+}
+
+void ResetNumBoostStates() {
+  std::lock_guard<std::mutex> lock(numboostlock);
+  numboostsource="";
+  numboost.store(-1, std::memory_order_release);
+}
+
+const char* NumBoostStatesSource() {
+  NumBoostStates();
+  std::lock_guard<std::mutex> lock(numboostlock);
+  return numboostsource;
+}
+
+bool GetCpb(const int cpu, bool& enabled) {
+  uint64_t hwcr;
+  if (!MsrRead(cpu, MSRHWCR, hwcr)) {
+    return false;
+  }
+  enabled=(0 == GetBits(hwcr, HWCRCPBDIS, 1));
+  return true;
+}
+
+int SetCpb(const bool enabled) {
+  int failed[MAXCPUCORES]={0};
+  RunOnEachCore([enabled, &failed](int i) {
+      const int cpu=Core(i).cpu;
+      uint64_t hwcr;
+      if (!MsrRead(cpu, MSRHWCR, hwcr)) {
+        failed[i]=1;
+        return;
+      }
+      SetBits(hwcr, (enabled ? 0 : 1), HWCRCPBDIS, 1);
+      failed[i]=(MsrWrite(cpu, MSRHWCR, hwcr) ? 0 : 1);
+      });
+  int errors=0;
+  for (int i = 0; i < NumCores(); i++) {
+    errors += failed[i];
+  }
+  TelemetryBoost(enabled, errors);
+  return errors;
+}
+
+bool SetCpbForPState(const int hwpstate) {
+  if ((0 == NumBoostStates()) || (0 != HwToSw(hwpstate))) {
+    return true;
+  }
+  return (0 == SetCpb(IsBoostPState(hwpstate)));
+}
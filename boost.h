@@ -0,0 +1,39 @@
+#pragma once
+
+//Core Performance Boost(CPB): the fastest NumBoostStates() hardware P-states(0xc0010064+0..) are boost states, B0.. in AMD's docs
+//they can't be requested: 0xc0010061..63 count from the first non-boost state(software numbering), and while CPB is enabled the hardware itself
+//takes a core that requested software P0 up into the boost states, as long as there's thermal/power headroom; COFVID then reports hardware P0
+//everything else in this tool uses hardware numbering, HwToSw()/SwToHw() convert
+
+#define MSRHWCR 0xc0010015
+#define HWCRCPBDIS 25 //HWCR bit: 1 keeps the cores out of the boost states
+
+//D18F4x15C NumBoostStates(bits 4:2), read once from pci config space; if that can't be read it's 1, which is what the A6-3400M has; safe to call from any thread
+int NumBoostStates();
+//what NumBoostStates() says from now on, eg. for the simulated cpu(see simcpu.h); source is shown by the boost mode
+void SetNumBoostStates(const int n, const char* source);
+const char* NumBoostStatesSource();
+//forgets it again(eg. SetNumBoostStates()'s), the next NumBoostStates() reads D18F4x15C
+void ResetNumBoostStates();
+
+inline bool IsBoostPState(const int hwpstate) {
+  return hwpstate < NumBoostStates();
+}
+
+//a boost state becomes software P0, the closest there is to it
+inline int HwToSw(const int hwpstate) {
+  return (IsBoostPState(hwpstate) ? 0 : hwpstate - NumBoostStates());
+}
+
+inline int SwToHw(const int swpstate) {
+  return swpstate + NumBoostStates();
+}
+
+//false on msr access failure
+bool GetCpb(const int cpu, bool& enabled);
+//enables or disables boosting on all cores(in parallel), returns how many cores failed
+int SetCpb(const bool enabled);
+//for the modes that measure one P-state at a time(stress and so search, bench, energy): CPB so that requesting hwpstate runs exactly that definition,
+//on for a boost state and off for the first non-boost one(software P0 too, which would boost with CPB on); any other P-state leaves CPB as it is
+//false if it couldn't be switched; the caller puts back what GetCpb() said before
+bool SetCpbForPState(const int hwpstate);
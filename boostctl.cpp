@@ -0,0 +1,57 @@
+#include "boostctl.h"
+#include "mumu.h"
+#include "msr.h"
+#include "cores.h"
+#include "pstate.h"
+#include "boost.h"
+#include "codec.h"
+#include "options.h"
+
+#include <stdio.h>
+
+static int ShowBoost() {
+  int errors=0;
+  fprintf(stdout, "boost: %d boost state(s), from %s\n", NumBoostStates(), NumBoostStatesSource());
+  for (int p = 0; p < NumBoostStates(); p++) {
+    uint64_t def=0;
+    if (!MsrRead(Core(0).cpu, MSRPSTATEDEF0 + p, def)) {
+      errors++;
+      fprintf(stderr, ERRORtext("!! boost: failed to read the definition of B%d") "\n", p);
+      continue;
+    }
+    fprintf(stdout, "  B%d: %gx(%.0fMHz) at %.4fV\n", p, Codec().multi(def), Codec().multi(def) * DEFAULTREFERENCECLOCK, Codec().voltage(Codec().vid(def)));
+  }
+  fprintf(stdout, "  cpu  core  cpb  running\n");
+  for (int i = 0; i < NumCores(); i++) {
+    const int cpu=Core(i).cpu;
+    bool enabled=false;
+    const int running=GetCorePState(cpu);
+    if (!GetCpb(cpu, enabled) || (-1 == running)) {
+      errors++;
+      fprintf(stderr, ERRORtext("!! boost: failed to read the msrs of cpu%d") "\n", cpu);
+      continue;
+    }
+    fprintf(stdout, "  %3d  %4d  %-3s  %s%d\n", cpu, Core(i).coreid, (enabled ? "on" : "off"), (IsBoostPState(running) ? "B" : "P"), running);
+  }
+  return errors;
+}
+
+int RunBoost(const int argc, const char* argv[]) {
+  const bool on=HasArg(argc, argv, "--on");
+  const bool off=HasArg(argc, argv, "--off");
+  if (on && off) {
+    fprintf(stderr, ERRORtext("!! boost: --on or --off, not both") "\n");
+    return 2;
+  }
+  if (0 == NumBoostStates()) {
+    fprintf(stdout, "boost: this cpu has no boost states\n");
+    return (on ? 1 : 0);
+  }
+  int errors=0;
+  if (on || off) {
+    errors=SetCpb(on);
+    fprintf(stdout, "boost: %s on %d of %d cores\n", (on ? "enabled" : "disabled"), NumCores() - errors, NumCores());
+  }
+  errors += ShowBoost();
+  return (0 == errors ? 0 : 1);
+}
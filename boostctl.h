@@ -0,0 +1,6 @@
+#pragma once
+
+//Core Performance Boost view and control: how many boost states there are(and where that came from), their definitions, and per core whether CPB is enabled and which state it runs in
+//options: --on or --off enables/disables boosting on all cores(HWCR CpbDis), eg. off for sustained all-core runs where the boost state only adds heat; not persistent across reboots
+//returns the process exit code
+int RunBoost(const int argc, const char* argv[]);
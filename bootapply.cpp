@@ -0,0 +1,28 @@
+//minimal boot/resume-time apply: no iostream, no register dumps, one diff/write/verify pass over all cores(rolled back on failure), a one-line summary and an exit status
+//exit status: 0 applied(or nothing to do), 1 some msr access or transition failed, 2 no cpus/msr devices(# modprobe msr), 3 not the cpu the profiles are for
+
+#include "mumu.h"
+#include "profile.h"
+#include "apply.h"
+#include "cores.h"
+#include "msr.h"
+#include "timing.h"
+
+#include <stdio.h>
+
+int main() {
+  const int64_t start=NowNs();
+  if (!IsProfileCpu()) {
+    fprintf(stderr, "amdmsrt-apply: not a family %xh model %xh AMD cpu, not applying\n", CPUFAMILY, CPUMODEL);
+    return 3;
+  }
+  if ((DiscoverTopology() <= 0) || !MsrOpenAll()) {
+    perror("amdmsrt-apply: no online cpus or msr devices(modprobe msr)");
+    return 2;
+  }
+  ApplySummary summary;
+  const bool ok=ApplyCoreProfiles(summary);
+  fprintf(stdout, "amdmsrt-apply: %d cores, %d registers written, %d cores switched, %d errors%s, %.2fms\n",
+      summary.cores, summary.written, summary.switched, summary.errors, (summary.rolledback ? " (rolled back)" : ""), (NowNs() - start) / 1e6);
+  return (ok ? 0 : 1);
+}
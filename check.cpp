@@ -0,0 +1,221 @@
+//make check: self-tests against the simulated family 12h cpu(see simcpu.h), nothing real is touched
+//prints each failed check and exits 1 if there was any
+#include "mumu.h"
+#include "codec.h"
+#include "profile.h"
+#include "msr.h"
+#include "cores.h"
+#include "pstate.h"
+#include "snapshot.h"
+#include "apply.h"
+#include "boost.h"
+#include "simcpu.h"
+#include "timing.h"
+#include "amdmsrt.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static int checks=0, failures=0;
+
+#define CHECK(cond, fmt, ...) do { \
+    checks++; \
+    if (!(cond)) { \
+      failures++; \
+      fprintf(stderr, ERRORtext("!! %s:%d: %s failed: ") fmt "\n", __FILE__, __LINE__, #cond, __VA_ARGS__); \
+    } \
+  } while (0)
+
+//the divisor fields' reserved values, per family's BKDG
+static bool PowerOf2Defined(const uint64_t f) { return GetBits(f, 6, 3) <= 4; }
+static bool Family12hDefined(const uint64_t f) { return GetBits(f, 0, 4) <= 8; }
+static bool Family14hDefined(const uint64_t f) { return (GetBits(f, 4, 5) <= 26) && (GetBits(f, 0, 4) <= 3); }
+
+//every frequency part with a defined divisor has to encode back to one decoding the same, with any VID that fits
+template <typename C> static void CheckCodecRoundTrip(const char* name, const int numvids, bool (*defined)(const uint64_t f)) {
+  for (uint64_t f = 0; f <= 0x1ff; f++) {
+    const double multi=C::Multi(f);
+    if (!defined(f)) {
+      continue;
+    }
+    for (int vid = 0; vid < numvids; vid += 7) {
+      uint64_t bits=0;
+      const bool ok=C::Encode(multi, vid, bits);
+      CHECK(ok && (C::Multi(bits) == multi) && (C::Vid(bits) == vid) && (0 == (bits & ~C::mask)),
+          "%s: bits %03" PRIx64 " multi %g vid %d -> %d, %04" PRIx64, name, f, multi, vid, (int)ok, bits);
+    }
+  }
+  for (int vid = 0; (vid < numvids) && (C::VidToVoltage(vid) >= 0.0); vid++) {//SVI2's last VIDs are below 0V, ie. off
+    CHECK(C::VoltageToVid(C::VidToVoltage(vid)) == vid, "%s: vid %d -> %.5fV -> vid %d", name, vid, C::VidToVoltage(vid), C::VoltageToVid(C::VidToVoltage(vid)));
+  }
+  uint64_t bits=0;
+  CHECK(!C::Encode(0.25, 0, bits), "%s: multi 0.25 encoded as %04" PRIx64, name, bits);
+  CHECK(!C::Encode(14.0, numvids, bits), "%s: vid %d encoded as %04" PRIx64, name, numvids, bits);
+}
+
+static void CheckCodecs() {
+  CheckCodecRoundTrip<Codec10h>("10h", 128, PowerOf2Defined);
+  CheckCodecRoundTrip<Codec11h>("11h", 128, PowerOf2Defined);
+  CheckCodecRoundTrip<Codec12h>("12h", 128, Family12hDefined);
+  const int savedpllfid=mainpllfid;
+  mainpllfid=0x10;//no D18F3 here, any main PLL will do
+  CheckCodecRoundTrip<Codec14h>("14h", 128, Family14hDefined);
+  mainpllfid=savedpllfid;
+  CheckCodecRoundTrip<Codec15h>("15h", 128, PowerOf2Defined);
+  CheckCodecRoundTrip<Codec15hSvi2>("15h SVI2", 256, PowerOf2Defined);
+
+  //the runtime codec and the compile time profile encoding have to agree
+  for (int p = 0; p < NUMPSTATES; p++) {
+    uint64_t bits=0;
+    CHECK(Codec12h::Encode(allpsi[p].multi, allpsi[p].VID, bits) && (bits == allpsiwords[p].lo), "allpsi P%d: %04" PRIx64 " != %04" PRIx64, p, bits, allpsiwords[p].lo);
+    CHECK(Codec12h::VoltageToVid(allpsi[p].strvid) == allpsi[p].VID, "allpsi P%d: %.4fV is vid %d, not %d", p, allpsi[p].strvid, Codec12h::VoltageToVid(allpsi[p].strvid), allpsi[p].VID);
+  }
+
+  //and decode what the simulated cpu boots with
+  CHECK(0 == strcmp("12h", Codec().name), "the simulated cpu selected codec %s", Codec().name);
+  for (int p = 0; p < NUMPSTATES; p++) {
+    const uint64_t def=Rdmsr(MSRPSTATEDEF0 + p);
+    CHECK((Codec().multi(def) == bootdefaults_psi[p].multi) && (Codec().vid(def) == bootdefaults_psi[p].VID), "simulated P%d: %04" PRIx64 " is %gx vid %d", p, def, Codec().multi(def), Codec().vid(def));
+  }
+}
+
+//COFVID can still show the previous P-state after the request was acknowledged, eg. leaving a boost state(acknowledged as software P0 either way)
+static int RunningAfterTransition(const int cpu, const int expected) {
+  const int64_t start=NowNs();
+  int running=GetCorePState(cpu);
+  while ((running != expected) && (NowNs() - start < PSTATETRANSITIONTIMEOUTNS)) {
+    running=GetCorePState(cpu);
+  }
+  return running;
+}
+
+//hardware numbering(0xc0010064+N, COFVID) vs software numbering(0xc0010061..63), for any number of boost states
+static void CheckBoostNumbering() {
+  for (int n = 0; n < NUMPSTATES; n++) {
+    SetNumBoostStates(n, "check");
+    CHECK(NumBoostStates() == n, "SetNumBoostStates(%d) reads back %d", n, NumBoostStates());
+    for (int hw = 0; hw < NUMPSTATES; hw++) {
+      CHECK(IsBoostPState(hw) == (hw < n), "%d boost states: hardware P%d", n, hw);
+      CHECK(HwToSw(hw) == (hw < n ? 0 : hw - n), "%d boost states: hardware P%d is software P%d", n, hw, HwToSw(hw));
+      CHECK(IsBoostPState(hw) || (SwToHw(HwToSw(hw)) == hw), "%d boost states: hardware P%d -> %d", n, hw, SwToHw(HwToSw(hw)));
+    }
+    for (int sw = 0; sw < NUMPSTATES - n; sw++) {
+      CHECK((HwToSw(SwToHw(sw)) == sw) && !IsBoostPState(SwToHw(sw)), "%d boost states: software P%d -> hardware P%d", n, sw, SwToHw(sw));
+    }
+  }
+  SetNumBoostStates(SIMNUMBOOSTSTATES, "the simulated family 12h cpu");
+
+  //and what the simulated cpu does with it: a request goes out in software numbering, COFVID reports it in hardware numbering, software P0 boosts while CPB is on and the die is cool
+  const int cpu=Core(0).cpu;
+  bool cpb=false;
+  CHECK(GetCpb(cpu, cpb) && cpb, "cpu%d: CPB %d", cpu, (int)cpb);
+  for (int hw = NUMPSTATES - 1; hw >= 0; hw--) {
+    uint64_t status=0;
+    const int64_t latency=SetCorePState(cpu, hw);
+    CHECK((latency >= 0) && MsrRead(cpu, MSRPSTATESTATUS, status) && ((int)GetBits(status, 0, 3) == HwToSw(hw)), "cpu%d: hardware P%d acknowledged as software P%d(%" PRId64 ")", cpu, hw, (int)GetBits(status, 0, 3), latency);
+    const int expected=(0 == HwToSw(hw) ? 0 : hw);//software P0 boosts
+    const int running=RunningAfterTransition(cpu, expected);
+    CHECK(running == expected, "cpu%d: asked for hardware P%d, COFVID says P%d", cpu, hw, running);
+  }
+  CHECK(0 == SetCpb(false), "%s", "disabling CPB");
+  CHECK(SetCorePState(cpu, 0) >= 0, "cpu%d: requesting software P0 without CPB", cpu);
+  const int running=RunningAfterTransition(cpu, SwToHw(0));
+  CHECK(running == SwToHw(0), "cpu%d: without CPB software P0 runs in hardware P%d", cpu, running);
+  CHECK(0 == SetCpb(true), "%s", "enabling CPB");
+
+  //measuring software P0 turns CPB off so it runs its own definition, measuring a boost state turns it back on, the others leave it alone
+  CHECK(SetCpbForPState(SwToHw(0)) && GetCpb(cpu, cpb) && !cpb, "software P0(hardware P%d): CPB %d", SwToHw(0), (int)cpb);
+  CHECK(SetCpbForPState(SwToHw(1)) && GetCpb(cpu, cpb) && !cpb, "software P1(hardware P%d): CPB %d", SwToHw(1), (int)cpb);
+  CHECK(SetCpbForPState(0) && GetCpb(cpu, cpb) && cpb, "boost state P0: CPB %d", (int)cpb);
+}
+
+static bool SameDefinitions(const PStateSnapshot& a, const PStateSnapshot& b) {
+  for (int i = 0; i < a.numcores; i++) {
+    for (int p = 0; p < NUMPSTATES; p++) {
+      if (a.pstatedef[p][i] != b.pstatedef[p][i]) {
+        return false;
+      }
+    }
+  }
+  return a.numcores == b.numcores;
+}
+
+//the transactional apply(apply.h): a write failing part way through leaves every core's definitions as they were, one that goes through writes only what differs
+static void CheckApplyRollback() {
+  PStateSnapshot before, after;
+  CHECK(TakeSnapshot(before), "%s", "snapshot before");
+
+  //the last core's P5 fails after the other cores(each from its own thread) may have written all of theirs
+  const int lastcpu=Core(NumCores() - 1).cpu;
+  SimFailNextWrite(lastcpu, MSRPSTATEDEF0 + 5);
+  ApplySummary summary;
+  CHECK(!ApplyProfile(allpsiwords, summary), "%s", "apply with a failing write succeeded");
+  CHECK(summary.rolledback && (1 == summary.errors) && (0 == summary.written) && (0 == summary.switched), "rolledback %d errors %d written %d switched %d",
+      (int)summary.rolledback, summary.errors, summary.written, summary.switched);
+  CHECK(TakeSnapshot(after) && SameDefinitions(before, after), "%s", "definitions differ after the rollback");
+
+  //the same apply without the fault, then again with nothing left to write
+  CHECK(ApplyProfile(allpsiwords, summary) && !summary.rolledback && (summary.written == summary.differing) && (summary.differing > 0),
+      "differing %d written %d errors %d", summary.differing, summary.written, summary.errors);
+  CHECK(TakeSnapshot(after), "%s", "snapshot after");
+  for (int i = 0; i < after.numcores; i++) {
+    for (int p = 0; p < NUMPSTATES; p++) {
+      CHECK((after.pstatedef[p][i] & Codec().mask) == allpsiwords[p].lo, "cpu%d P%d: %04" PRIx64 " != %04" PRIx64, after.cpu[i], p, after.pstatedef[p][i] & Codec().mask, allpsiwords[p].lo);
+      CHECK((after.pstatedef[p][i] & ~Codec().mask) == (before.pstatedef[p][i] & ~Codec().mask), "cpu%d P%d: bits outside the codec's changed", after.cpu[i], p);
+    }
+  }
+  CHECK(ApplyProfile(allpsiwords, summary) && (0 == summary.differing) && (0 == summary.written), "differing %d written %d", summary.differing, summary.written);
+
+  //and a rollback of a core that had already written some of its registers restores those too
+  PStateSnapshot applied=after;
+  SimFailNextWrite(lastcpu, MSRPSTATEDEF0 + 7);
+  PStateWord words[NUMPSTATES];
+  for (int p = 0; p < NUMPSTATES; p++) {
+    words[p]=allpsiwords[p];
+    words[p].lo=(before.pstatedef[p][0] & Codec().mask);//back to the boot definitions, P0..P7 in that order on every core
+  }
+  CHECK(!ApplyProfile(words, summary) && summary.rolledback, "rolledback %d", (int)summary.rolledback);
+  CHECK(TakeSnapshot(after) && SameDefinitions(applied, after), "%s", "definitions differ after the second rollback");
+  CHECK(ApplyProfile(words, summary) && TakeSnapshot(after) && SameDefinitions(before, after), "%s", "putting the boot definitions back");
+}
+
+//the library's runtime table checks have to refuse what profile.h refuses at compile time, before writing anything
+static void CheckLibraryTable() {
+  CHECK(AMDMSRT_OK == amdmsrt_open(AMDMSRT_OPEN_SIM), "%s", "opening the library on the simulated cpu");
+  amdmsrt_pstate table[NUMPSTATES];
+  for (int p = 0; p < NUMPSTATES; p++) {
+    table[p]={ allpsi[p].multi, allpsi[p].strvid };
+  }
+  const struct { int row; double multi, voltage; const char* what; } bad[]={
+    { 0, 40.0, allpsi[0].strvid, "a multi above 30x" },
+    { NUMPSTATES - 1, 4.0, allpsi[NUMPSTATES - 1].strvid, "a multi below 8x" },
+    { NUMPSTATES - 1, allpsi[NUMPSTATES - 1].multi, 0.5, "0.5V" },
+    { 0, allpsi[0].multi, 1.35, "1.35V" },
+    { 1, allpsi[0].multi + 1.0, allpsi[1].strvid, "a faster P1 than P0" },
+    { 1, allpsi[1].multi, allpsi[0].strvid + 0.0125, "a higher voltage P1 than P0" },
+  };
+  PStateSnapshot before, after;
+  CHECK(TakeSnapshot(before), "%s", "snapshot before");
+  for (const auto& b : bad) {
+    amdmsrt_pstate row=table[b.row];
+    table[b.row]={ b.multi, b.voltage };
+    CHECK(AMDMSRT_EINVAL == amdmsrt_apply_profile(table, NULL), "table with %s in P%d accepted", b.what, b.row);
+    table[b.row]=row;
+  }
+  CHECK(TakeSnapshot(after) && SameDefinitions(before, after), "%s", "a refused table changed the definitions");
+  CHECK(AMDMSRT_OK == amdmsrt_apply_profile(table, NULL), "%s", "allpsi as a library table refused");
+}
+
+int main() {
+  SimActivate();
+  if ((DiscoverTopology() <= 0) || !MsrOpenAll()) {
+    fprintf(stderr, ERRORtext("!! check: failed to open the simulated cpu") "\n");
+    return 1;
+  }
+  CheckCodecs();
+  CheckBoostNumbering();
+  CheckApplyRollback();
+  CheckLibraryTable();
+  fprintf(stdout, "check: %d checks, %d failed\n", checks, failures);
+  return (0 == failures ? 0 : 1);
+}
@@ -0,0 +1,91 @@
+#include "codec.h"
+
+#include <stdio.h>
+#include <string.h> //memcpy memcmp
+#include <fcntl.h>
+#include <unistd.h>
+#include <cpuid.h>
+
+#define PCIMISCCONFIG "/sys/bus/pci/devices/0000:00:18.3/config" //D18F3
+#define CLOCKPOWERTIMINGCONTROL0 0xd4 //D18F3xD4, MainPllOpFreqId in bits 5:0
+
+int mainpllfid=0;
+
+template <typename C> constexpr CodecOps MakeCodecOps(const char* name, const unsigned int family) {
+  return { name, family, C::mask, C::Multi, C::Vid, C::VidToVoltage, C::VoltageToVid, C::Encode };
+}
+
+enum { CODEC10H, CODEC11H, CODEC12H, CODEC14H, CODEC15H, CODEC15HSVI2, NUMCODECS };
+
+static const CodecOps codecs[NUMCODECS]={
+  MakeCodecOps<Codec10h>("10h", 0x10),
+  MakeCodecOps<Codec11h>("11h", 0x11),
+  MakeCodecOps<Codec12h>("12h", 0x12),
+  MakeCodecOps<Codec14h>("14h", 0x14),
+  MakeCodecOps<Codec15h>("15h", 0x15),
+  MakeCodecOps<Codec15hSvi2>("15h SVI2", 0x15),
+};
+
+static const CodecOps* selected=&codecs[CODEC12H];
+
+const CodecOps& Codec() {
+  return *selected;
+}
+
+bool CpuidFamilyModel(unsigned int& family, unsigned int& model) {
+  unsigned int eax=0, ebx=0, ecx=0, edx=0;
+  if (!__get_cpuid(0, &eax, &ebx, &ecx, &edx)) {
+    return false;
+  }
+  char vendor[12];
+  memcpy(vendor, &ebx, 4);
+  memcpy(vendor + 4, &edx, 4);
+  memcpy(vendor + 8, &ecx, 4);
+  if (0 != memcmp(vendor, "AuthenticAMD", sizeof(vendor))) {
+    return false;
+  }
+  if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+    return false;
+  }
+  family=GetBits(eax, 8, 4) + GetBits(eax, 20, 8);//BaseFamily + ExtFamily
+  model=GetBits(eax, 4, 4) | (GetBits(eax, 16, 4) << 4);//BaseModel | ExtModel<<4
+  return true;
+}
+
+static bool ReadMainPllFid() {
+  const int fd=open(PCIMISCCONFIG, O_RDONLY | O_CLOEXEC);
+  if (-1 == fd) {
+    return false;
+  }
+  uint32_t reg=0;
+  const bool ok=(sizeof(reg) == pread(fd, &reg, sizeof(reg), CLOCKPOWERTIMINGCONTROL0));
+  close(fd);
+  if (ok) {
+    mainpllfid=GetBits(reg, 0, 6);
+  }
+  return ok;
+}
+
+bool SelectCodec(const unsigned int family, const unsigned int model) {
+  int idx;
+  switch (family) {
+    case 0x10: idx=CODEC10H; break;
+    case 0x11: idx=CODEC11H; break;
+    case 0x12: idx=CODEC12H; break;
+    case 0x14:
+      if (!ReadMainPllFid()) {
+        return false;//the multipliers are meaningless without it
+      }
+      idx=CODEC14H;
+      break;
+    case 0x15: idx=(model >= 0x10 ? CODEC15HSVI2 : CODEC15H); break;//Trinity and later are SVI2
+    default: return false;
+  }
+  selected=&codecs[idx];
+  return true;
+}
+
+bool SelectCodecFromCpuid() {
+  unsigned int family=0, model=0;
+  return CpuidFamilyModel(family, model) && SelectCodec(family, model);
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include "mumu.h"
+
+//P-state definition codec, per cpu family: how the multiplier and the voltage are packed into 0xc0010064+N(and COFVID status, which uses the same low bits)
+//each family is a compile time combination of a frequency part and a voltage part; the one for this cpu is picked once at startup from CPUID(SelectCodecFromCpuid()) and called through CodecOps, so the per-register paths have no family checks in them
+
+//SVI1: 7 bit VID at 15:9, 12.5mV steps down from 1.55V; SVI2: 8 bit VID at 16:9, 6.25mV steps
+template <int VidBits, int VidStepUv> struct SviVoltage {
+  static constexpr uint64_t mask = (((1ULL << VidBits) - 1) << 9);
+  static constexpr int Vid(const uint64_t msr) { return GetBits(msr, 9, VidBits); }
+  static constexpr double Voltage(const int vid) { return V155 - vid * (VidStepUv / 1e6); }
+  static constexpr int VoltageToVid(const double voltage) { return (int)(V155 / (VidStepUv / 1e6) + 0.5) - (int)(voltage / (VidStepUv / 1e6) + 0.5); }
+  static constexpr bool ValidVid(const int vid) { return (vid >= 0) && (vid < (1 << VidBits)); }
+};
+
+//10h, 11h, 15h: 6 bit FID at 5:0, 3 bit DID at 8:6, multi = (FID + NumeratorOffset) / 2^DID
+template <int NumeratorOffset> struct PowerOf2Frequency {
+  static constexpr uint64_t mask = 0x1ff;
+  static constexpr double Multi(const uint64_t msr) { return (GetBits(msr, 0, 6) + NumeratorOffset) / (double)(1 << GetBits(msr, 6, 3)); }
+  static constexpr bool Encode(const double multi, uint64_t& bits) {
+    for (int did = 0; did <= 4; did++) {
+      const double numerator=multi * (1 << did);
+      const int fid=(int)(numerator + 0.5) - NumeratorOffset;
+      if ((fid >= 0) && (fid <= 63) && (fid + NumeratorOffset == numerator)) {
+        bits=((uint64_t)did << 6) | (uint64_t)fid;
+        return true;
+      }
+    }
+    return false;
+  }
+};
+
+//12h: 5 bit FID at 8:4, 4 bit DID at 3:0 indexing DIVISORS_12, multi = (FID + 16) / divisor; the same search FindFraction() does for the profiles
+struct Family12hFrequency {
+  static constexpr uint64_t mask = 0x1ff;
+  static constexpr double Multi(const uint64_t msr) { return (GetBits(msr, 0, 4) < 9 ? (GetBits(msr, 4, 5) + 16) / DIVISORS_12[GetBits(msr, 0, 4)] : 0.0); }
+  static constexpr bool Encode(const double multi, uint64_t& bits) {
+    for (int did = 0; did < 9; did++) {
+      const double numerator=multi * DIVISORS_12[did];
+      const int fid=(int)(numerator + 0.5) - 16;
+      if ((fid >= 0) && (fid <= 31) && (fid + 16 == numerator)) {
+        bits=((uint64_t)fid << 4) | (uint64_t)did;
+        return true;
+      }
+    }
+    return false;
+  }
+};
+
+//14h: no FID per P-state, one main PLL(D18F3xD4 MainPllOpFreqId, read at startup) divided by CpuDidMSD(8:4) + CpuDidLSD(3:0)/4 + 1
+extern int mainpllfid;
+struct Family14hFrequency {
+  static constexpr uint64_t mask = 0x1ff;
+  static double Multi(const uint64_t msr) { return (mainpllfid + 16) / (GetBits(msr, 4, 5) + GetBits(msr, 0, 4) * 0.25 + 1.0); }
+  static bool Encode(const double multi, uint64_t& bits) {
+    for (int msd = 0; msd <= 26; msd++) {
+      for (int lsd = 0; lsd <= 3; lsd++) {
+        if ((mainpllfid + 16) / (msd + lsd * 0.25 + 1.0) == multi) {
+          bits=((uint64_t)msd << 4) | (uint64_t)lsd;
+          return true;
+        }
+      }
+    }
+    return false;
+  }
+};
+
+template <typename Frequency, typename Voltage> struct PStateCodec {
+  static constexpr uint64_t mask = Frequency::mask | Voltage::mask;
+  static double Multi(const uint64_t msr) { return Frequency::Multi(msr); }
+  static int Vid(const uint64_t msr) { return Voltage::Vid(msr); }
+  static double VidToVoltage(const int vid) { return Voltage::Voltage(vid); }
+  static int VoltageToVid(const double voltage) { return Voltage::VoltageToVid(voltage); }
+  //the codec's bits(see mask) for that multi and vid, false if the multi isn't exactly representable or the vid doesn't fit
+  static bool Encode(const double multi, const int vid, uint64_t& bits) {
+    uint64_t f=0;
+    if (!Frequency::Encode(multi, f) || !Voltage::ValidVid(vid)) {
+      return false;
+    }
+    bits=f | ((uint64_t)vid << 9);
+    return true;
+  }
+};
+
+typedef PStateCodec<PowerOf2Frequency<16>, SviVoltage<7, 12500>> Codec10h;
+typedef PStateCodec<PowerOf2Frequency<8>, SviVoltage<7, 12500>> Codec11h;
+typedef PStateCodec<Family12hFrequency, SviVoltage<7, 12500>> Codec12h;
+typedef PStateCodec<Family14hFrequency, SviVoltage<7, 12500>> Codec14h;
+typedef PStateCodec<PowerOf2Frequency<16>, SviVoltage<7, 12500>> Codec15h;
+typedef PStateCodec<PowerOf2Frequency<16>, SviVoltage<8, 6250>> Codec15hSvi2;
+
+//the selected family's codec as a table of plain function pointers
+struct CodecOps {
+  const char* name;
+  unsigned int family;
+  uint64_t mask; //the bits of a P-state definition the codec owns(fid/did/vid), writes keep all the others
+  double (*multi)(const uint64_t msr);
+  int (*vid)(const uint64_t msr);
+  double (*voltage)(const int vid);
+  int (*voltage2vid)(const double voltage);
+  bool (*encode)(const double multi, const int vid, uint64_t& bits);
+};
+
+const CodecOps& Codec();//family 12h until something else gets selected
+//reads CPUID family/model(and D18F3xD4 on 14h) and selects the matching codec; false(and the 12h one stays) if it's not an AMD cpu this knows
+bool SelectCodecFromCpuid();
+//selects the codec for that family/model, eg. 0x12 for the simulated cpu; false if unknown
+bool SelectCodec(const unsigned int family, const unsigned int model);
+//CPUID leaf 0/1: vendor check plus the family/model with the extended fields added in
+bool CpuidFamilyModel(unsigned int& family, unsigned int& model);
@@ -0,0 +1,71 @@
+#include "corepstate.h"
+#include "mumu.h"
+#include "msr.h"
+#include "cores.h"
+#include "pstate.h"
+#include "profile.h"
+#include "boost.h"
+#include "options.h"
+
+#include <stdio.h>
+
+static void ShowCores() {
+  fprintf(stdout, "  cpu  core  running  requested  hwlimit  slowest  profile\n");
+  for (int i = 0; i < NumCores(); i++) {
+    const int cpu=Core(i).cpu;
+    const int running=GetCorePState(cpu);
+    uint64_t control=0;
+    const bool controlok=MsrRead(cpu, MSRPSTATECONTROL, control);
+    int curlimit=-1, maxval=-1;
+    const bool limitok=GetCorePStateLimit(cpu, curlimit, maxval);
+    if ((-1 == running) || !controlok || !limitok) {
+      fprintf(stderr, ERRORtext("!! pstate: failed to read the msrs of cpu%d") "\n", cpu);
+      continue;
+    }
+    fprintf(stdout, "  %3d  %4d  %s%-7d P%-9d P%-7d P%-7d %s\n", cpu, Core(i).coreid, (IsBoostPState(running) ? "B" : "P"), running,
+        SwToHw(GetBits(control, 0, 3)), curlimit, maxval, (ProfileOfCpu(cpu).words == allpsiwords ? "allpsi" : "own"));
+  }
+}
+
+int RunCorePState(const int argc, const char* argv[]) {
+  int cpus[MAXCPUCORES];
+  int numcpus=OptIntList(argc, argv, "--cpus", cpus, MAXCPUCORES);
+  if (-1 == numcpus) {
+    if (NULL != OptValue(argc, argv, "--cpus")) {
+      fprintf(stderr, ERRORtext("!! pstate: --cpus wants a list eg. --cpus=1,3") "\n");
+      return 2;
+    }
+    numcpus=NumCores();
+    for (int i = 0; i < numcpus; i++) {
+      cpus[i]=Core(i).cpu;
+    }
+  }
+  for (int i = 0; i < numcpus; i++) {
+    if (-1 == CoreIndexOfCpu(cpus[i])) {
+      fprintf(stderr, ERRORtext("!! pstate: cpu%d is not online") "\n", cpus[i]);
+      return 2;
+    }
+  }
+
+  const int set=OptInt(argc, argv, "--set", -1);
+  if (-1 == set) {
+    ShowCores();
+    return 0;
+  }
+  if ((set < 0) || (set >= NUMPSTATES)) {
+    fprintf(stderr, ERRORtext("!! pstate: --set wants 0..%d") "\n", NUMPSTATES - 1);
+    return 2;
+  }
+  int errors=0;
+  for (int i = 0; i < numcpus; i++) {
+    const int64_t latency=SetCorePState(cpus[i], set);
+    if (latency < 0) {
+      errors++;
+      fprintf(stderr, ERRORtext("!! pstate: cpu%d %s switching to P%d") "\n", cpus[i], (-2 == latency ? "timed out" : "failed msr access"), set);
+    } else {
+      fprintf(stdout, "pstate: cpu%d requested P%d, acknowledged after %.1fus\n", cpus[i], set, latency / 1000.0);
+    }
+  }
+  ShowCores();
+  return (0 == errors ? 0 : 1);
+}
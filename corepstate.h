@@ -0,0 +1,7 @@
+#pragma once
+
+//per-core P-state view and control: for each online cpu the P-state it runs in, the one requested, the hardware limit(0xc0010061) and which profile it has(see ProfileOfCpu() in profile.h)
+//options: --cpus=1,3 (default all) --set=P to request P-state P on those cpus only, eg. a fast core for a latency critical thread and slow ones for the rest
+//0xc0010061 is read-only, so there's no persistent per-core limit and no --cap here: a cap(see SetCorePStateCap() in pstate.h) only lasts as long as the process that set it; the governor's --cap keeps cores capped while it runs
+//returns the process exit code
+int RunCorePState(const int argc, const char* argv[]);
@@ -0,0 +1,243 @@
+#include "cores.h"
+#include "mumu.h"
+
+#ifndef AMDMSRT_BOOTAPPLY
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#endif
+#include <pthread.h> //pthread_setaffinity_np
+#include <sched.h> //cpu_set_t
+#include <signal.h> //sigfillset
+#include <stdio.h>
+#include <stdlib.h> //strtol
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <linux/netlink.h> //NETLINK_KOBJECT_UEVENT
+
+static CoreInfo cores[MAXCPUCORES];
+static int numcores=0;
+
+static bool ReadSysfsInt(const char* path, int& value) {
+  FILE* f=fopen(path, "r");
+  if (NULL == f) {
+    return false;
+  }
+  const bool ok=(1 == fscanf(f, "%d", &value));
+  fclose(f);
+  return ok;
+}
+
+static int simulatedcores=0;
+
+void SetSimulatedTopology(const int n) {
+  simulatedcores=(n > MAXCPUCORES ? MAXCPUCORES : n);
+}
+
+int DiscoverTopology() {
+  if (simulatedcores > 0) {
+    for (int i = 0; i < simulatedcores; i++) {
+      cores[i].cpu=i;
+      cores[i].package=0;
+      cores[i].coreid=i;
+    }
+    numcores=simulatedcores;
+    return numcores;
+  }
+  FILE* f=fopen("/sys/devices/system/cpu/online", "r");
+  if (NULL == f) {
+    return 0;//the caller reports it, this is in libamdmsrt too
+  }
+  char list[1024]="\0";
+  const bool ok=(NULL != fgets(list, sizeof(list), f));
+  fclose(f);
+  if (!ok) {
+    return 0;
+  }
+
+  //the list looks like: 0-3,5,7-8
+  int found=0;
+  char* p=list;
+  while ((*p >= '0') && (*p <= '9')) {
+    const int first=(int)strtol(p, &p, 10);
+    int last=first;
+    if ('-' == *p) {
+      last=(int)strtol(p+1, &p, 10);
+    }
+    for (int cpu = first; (cpu <= last) && (found < MAXCPUCORES); cpu++) {
+      char path[255]="\0";
+      cores[found].cpu=cpu;
+      cores[found].package=0;
+      cores[found].coreid=cpu;
+      snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/physical_package_id", cpu);
+      ReadSysfsInt(path, cores[found].package);
+      snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/core_id", cpu);
+      ReadSysfsInt(path, cores[found].coreid);
+      found++;
+    }
+    if (',' == *p) {
+      p++;
+    }
+  }
+  numcores=found;
+  return numcores;
+}
+
+int NumCores() {
+  return numcores;
+}
+
+const CoreInfo& Core(const int idx) {
+  return cores[idx];
+}
+
+int CoreIndexOfCpu(const int cpu) {
+  for (int i = 0; i < numcores; i++) {
+    if (cpu == cores[i].cpu) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+bool PinToCore(const int cpu) {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  return (0 == pthread_setaffinity_np(pthread_self(), sizeof(set), &set));
+}
+
+#ifdef AMDMSRT_BOOTAPPLY
+//the boot-time apply binary does a few dozen register accesses once: one core after the other from the main thread(the msr driver runs each access on its cpu anyway) is fast enough and keeps threads out of the static binary
+void RunOnEachCore(const std::function<void(int idx)>& fn) {
+  for (int i = 0; i < numcores; i++) {
+    fn(i);
+  }
+}
+#else
+//a thread per core just for this one call, for when the pool is busy(see below)
+static void RunOnNewThreads(const std::function<void(int idx)>& fn) {
+  std::thread threads[MAXCPUCORES];
+  const int n=numcores;
+  for (int i = 0; i < n; i++) {
+    threads[i]=std::thread([&fn, i]() {
+        PinToCore(cores[i].cpu);
+        fn(i);
+        });
+  }
+  for (int i = 0; i < n; i++) {
+    threads[i].join();
+  }
+}
+
+//the persistent workers: worker i is pinned to core i's cpu(re-pinned if a rediscovery moved that index to another cpu) and sleeps between jobs
+//started on first use and never stopped or freed, so nothing has to be torn down while they might still be waiting at exit
+struct CorePool {
+  std::mutex runlock; //one job at a time
+  std::mutex lock; //everything below
+  std::condition_variable wake;
+  std::condition_variable done;
+  const std::function<void(int idx)>* job=NULL;
+  uint64_t generation=0; //bumped for every job, a worker runs each generation once
+  int jobcores=0; //the workers with a lower index take part in the current job
+  int remaining=0;
+  int numworkers=0;
+};
+
+static CorePool* pool=NULL;
+static std::once_flag poolonce;
+
+static void WorkerLoop(const int i) {
+  //the workers outlive the call that started them, so they'd miss a sigprocmask() done later by a mode that waits for signals itself(run's SIGCHLD, the sampler's SIGUSR1): they never take any
+  sigset_t all;
+  sigfillset(&all);
+  pthread_sigmask(SIG_BLOCK, &all, NULL);
+  uint64_t seen=0;
+  int pinned=-1;
+  std::unique_lock<std::mutex> lock(pool->lock);
+  for (;;) {
+    pool->wake.wait(lock, [&seen]() { return pool->generation != seen; });
+    seen=pool->generation;
+    if (i >= pool->jobcores) {
+      continue;
+    }
+    const std::function<void(int idx)>* fn=pool->job;
+    const int cpu=cores[i].cpu;
+    lock.unlock();
+    if (cpu != pinned) {
+      PinToCore(cpu);
+      pinned=cpu;
+    }
+    (*fn)(i);
+    lock.lock();
+    if (0 == --pool->remaining) {
+      pool->done.notify_one();
+    }
+  }
+}
+
+void RunOnEachCore(const std::function<void(int idx)>& fn) {
+  std::call_once(poolonce, []() { pool=new CorePool(); });
+  //busy means either another thread's job(eg. a watcher thread switching P-states while the cores run a long job) or a call from inside a job: both get threads of their own instead of waiting, or deadlocking, for the pool
+  std::unique_lock<std::mutex> run(pool->runlock, std::try_to_lock);
+  if (!run.owns_lock()) {
+    RunOnNewThreads(fn);
+    return;
+  }
+  const int n=numcores;
+  std::unique_lock<std::mutex> lock(pool->lock);
+  while (pool->numworkers < n) {
+    std::thread(WorkerLoop, pool->numworkers).detach();
+    pool->numworkers++;
+  }
+  pool->job=&fn;
+  pool->jobcores=n;
+  pool->remaining=n;
+  pool->generation++;
+  pool->wake.notify_all();
+  pool->done.wait(lock, []() { return 0 == pool->remaining; });
+  pool->job=NULL;
+}
+#endif
+
+int HotplugOpen() {
+  const int fd=socket(AF_NETLINK, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, NETLINK_KOBJECT_UEVENT);
+  if (-1 == fd) {
+    return -1;
+  }
+  struct sockaddr_nl addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.nl_family=AF_NETLINK;
+  addr.nl_groups=1;//kernel uevents
+  if (-1 == bind(fd, (struct sockaddr*)&addr, sizeof(addr))) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+bool HotplugRead(const int fd, int& cpu, bool& online) {
+  char buf[4096];
+  const ssize_t len=recv(fd, buf, sizeof(buf)-1, 0);
+  if (len <= 0) {
+    return false;
+  }
+  buf[len]='\0';//the header is: action@devpath, followed by NUL separated KEY=value pairs
+  const char* const devpath="@/devices/system/cpu/cpu";
+  const char* at=strstr(buf, devpath);
+  if (NULL == at) {
+    return false;
+  }
+  const size_t actionlen=at-buf;
+  if ((strlen("online") == actionlen) && (0 == strncmp(buf, "online", actionlen))) {
+    online=true;
+  } else if ((strlen("offline") == actionlen) && (0 == strncmp(buf, "offline", actionlen))) {
+    online=false;
+  } else {
+    return false;//add/remove/change are not interesting, a cpu is only usable after 'online'
+  }
+  char* end=NULL;
+  cpu=(int)strtol(at + strlen(devpath), &end, 10);
+  return ((end != at + strlen(devpath)) && ('\0' == *end));
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <functional>
+
+#define MAXCPUCORES 64 //upper bound only, the online cores are discovered at runtime from sysfs
+
+struct CoreInfo {
+  int cpu; //logical cpu number, as in /dev/cpu/N/msr
+  int package; //topology/physical_package_id
+  int coreid; //topology/core_id
+};
+
+//(re)reads the set of online cpus and their package/core mapping from /sys/devices/system/cpu
+//returns the number of online cores found, 0 on failure(nothing usable in sysfs); prints nothing, that's up to the caller
+int DiscoverTopology();
+
+//makes DiscoverTopology() report that many cores(cpu0..n-1, one package) instead of reading sysfs, for the simulated cpu(see simcpu.h); 0 goes back to sysfs
+void SetSimulatedTopology(const int n);
+
+//the cores found by the last DiscoverTopology(), indexed 0..NumCores()-1 (which is not necessarily the cpu number, eg. if cpu1 is offline)
+int NumCores();
+const CoreInfo& Core(const int idx);
+int CoreIndexOfCpu(const int cpu);//-1 if that cpu isn't online(as of last discovery)
+
+//runs fn(idx) for every discovered core at the same time, each call from a thread pinned to that core; returns after all of them finished
+//the threads are kept(one per core, started on first use) and just woken for each call, so a register access of all cores doesn't pay for creating threads
+//pinning is best effort: if it fails fn still runs(the msr driver then just has to IPI the right core)
+void RunOnEachCore(const std::function<void(int idx)>& fn);
+
+//pins the calling thread to that cpu, returns false if that failed
+bool PinToCore(const int cpu);
+
+//cpu hotplug notifications(kernel uevents), so cores that come online later can be handled too
+int HotplugOpen();//returns a nonblocking fd to poll on, -1 on failure
+//reads one pending event, returns true and sets cpu/online if it was a cpu online/offline event
+bool HotplugRead(const int fd, int& cpu, bool& online);
@@ -0,0 +1,256 @@
+#include "energy.h"
+#include "mumu.h"
+#include "codec.h"
+#include "kernels.h"
+#include "pstate.h"
+#include "boost.h"
+#include "cores.h"
+#include "options.h"
+#include "timing.h"
+
+#include <stdio.h>
+#include <stdlib.h> //aligned_alloc strtoll
+#include <string.h>
+#include <unistd.h> //usleep
+#include <dirent.h>
+#include <atomic>
+#include <thread>
+
+//effective switched capacitance per core: the A6-3400M's 35W TDP spread over 4 cores at its 2.3GHz/1.325V boost state gives 35/(4*1.325^2*2.3e9) ~= 2.17nF
+//static leakage isn't modeled, so this overestimates the savings of the low states a bit
+#define CPUCEFFNF 2.17
+
+double ModelPowerWatts(const double multi, const double voltage, const int numcores) {
+  const double hz=multi * DEFAULTREFERENCECLOCK * 1e6;
+  return numcores * CPUCEFFNF * 1e-9 * voltage * voltage * hz;
+}
+
+//the best power source this machine has, in order: a hwmon energy counter(uJ), a hwmon power reading(uW), the battery's energy_now(uWh) or power_now(uW)
+enum PowerKind { POWERNONE, POWERHWMONENERGY, POWERHWMONPOWER, POWERBATTERYENERGY, POWERBATTERYPOWER };
+static PowerKind powerkind=POWERNONE;
+static char powerpath[512]="\0";
+
+static bool ReadSysfsValue(const char* path, double& value) {
+  FILE* f=fopen(path, "r");
+  if (NULL == f) {
+    return false;
+  }
+  long long v=0;
+  const bool ok=(1 == fscanf(f, "%lld", &v));
+  fclose(f);
+  value=(double)v;
+  return ok;
+}
+
+//looks for dir/*/file, first match wins
+static bool FindAttribute(const char* dir, const char* file) {
+  DIR* d=opendir(dir);
+  if (NULL == d) {
+    return false;
+  }
+  bool found=false;
+  struct dirent* entry;
+  while (!found && (NULL != (entry=readdir(d)))) {
+    if ('.' == entry->d_name[0]) {
+      continue;
+    }
+    char path[512]="\0";
+    snprintf(path, sizeof(path), "%s/%s/%s", dir, entry->d_name, file);
+    double v;
+    if (ReadSysfsValue(path, v)) {
+      snprintf(powerpath, sizeof(powerpath), "%s", path);
+      found=true;
+    }
+  }
+  closedir(d);
+  return found;
+}
+
+//the status next to the battery attribute in powerpath: on AC energy_now/power_now read 0, stand still or show the charge rate, none of which is what the cpu uses
+static bool BatteryDischarging() {
+  char path[sizeof(powerpath)]="\0";
+  snprintf(path, sizeof(path), "%s", powerpath);
+  char* slash=strrchr(path, '/');
+  if (NULL == slash) {
+    return false;
+  }
+  snprintf(slash, sizeof(path) - (slash - path), "/status");
+  FILE* f=fopen(path, "r");
+  if (NULL == f) {
+    return false;
+  }
+  char status[32]="\0";
+  const bool ok=(NULL != fgets(status, sizeof(status), f));
+  fclose(f);
+  return ok && (0 == strncmp("Discharging", status, strlen("Discharging")));
+}
+
+static void FindPowerSource() {
+  if (FindAttribute("/sys/class/hwmon", "energy1_input")) {
+    powerkind=POWERHWMONENERGY;
+  } else if (FindAttribute("/sys/class/hwmon", "power1_input") || FindAttribute("/sys/class/hwmon", "power1_average")) {
+    powerkind=POWERHWMONPOWER;
+  } else if (FindAttribute("/sys/class/power_supply", "energy_now")) {
+    powerkind=POWERBATTERYENERGY;
+  } else if (FindAttribute("/sys/class/power_supply", "power_now")) {
+    powerkind=POWERBATTERYPOWER;
+  }
+  if (((POWERBATTERYENERGY == powerkind) || (POWERBATTERYPOWER == powerkind)) && !BatteryDischarging()) {
+    fprintf(stderr, ERRORtext("!! energy: %s is only meaningful on battery and the battery isn't discharging(unplug the adapter), measuring nothing, model only") "\n", powerpath);
+    powerkind=POWERNONE;
+  }
+}
+
+//average watts while fn runs, -1 if there's nothing to measure with
+template <typename Fn> static double MeasureWatts(Fn fn) {
+  if (POWERNONE == powerkind) {
+    fn();
+    return -1.0;
+  }
+  if ((POWERHWMONPOWER == powerkind) || (POWERBATTERYPOWER == powerkind)) {
+    //instantaneous readings, averaged from a side thread while the work runs
+    std::atomic<bool> done(false);
+    double sum=0.0;
+    int n=0;
+    std::thread sampler([&]() {
+        while (!done.load()) {
+          double uw;
+          if (ReadSysfsValue(powerpath, uw)) {
+            sum += uw / 1e6;
+            n++;
+          }
+          usleep(100000);
+        }
+        });
+    fn();
+    done.store(true);
+    sampler.join();
+    return (n > 0 ? sum / n : -1.0);
+  }
+  //counters: the difference over the run
+  double before=0.0, after=0.0;
+  const bool okbefore=ReadSysfsValue(powerpath, before);
+  const int64_t start=NowNs();
+  fn();
+  const double seconds=(NowNs() - start) / 1e9;
+  if (!okbefore || !ReadSysfsValue(powerpath, after) || (seconds <= 0)) {
+    return -1.0;
+  }
+  if (POWERHWMONENERGY == powerkind) {
+    return (after - before) / 1e6 / seconds;//uJ
+  }
+  return (before - after) * 3.6e-3 / seconds;//uWh, the battery's energy goes down while discharging
+}
+
+int RunEnergy(const int argc, const char* argv[]) {
+  const int work=OptInt(argc, argv, "--work", 40);
+  const int idleseconds=OptInt(argc, argv, "--idle-seconds", 5);
+  const char* out=OptValue(argc, argv, "--out");
+  if (NULL == out) {
+    out="energy.csv";
+  }
+  if ((work <= 0) || (idleseconds < 0)) {
+    fprintf(stderr, ERRORtext("!! energy: invalid options") "\n");
+    return 2;
+  }
+  FILE* csv=fopen(out, "w");
+  if (NULL == csv) {
+    pERR("energy: failed to open the output file");
+    return 3;
+  }
+
+  FindPowerSource();
+  const int numcores=NumCores();
+  const int initialpstate=GetCurrentPState();
+  bool cpbwas=false;
+  if (!GetCpb(Core(0).cpu, cpbwas)) {
+    fclose(csv);
+    pERR("energy: failed to read whether boost is enabled");
+    return 3;
+  }
+  //the fixed work: fp and integer in L1/L2 plus a RAM sweep, the same per core at every P-state
+  //1 unit of work = one pass over these stresskernels[](fp-l1, int-l1, fp-l2, int-l2, stream-ram) on one core
+  const int kernels[]={0, 2, 1, 3, 4};
+  fprintf(stdout, "energy: power source: %s\n", (POWERNONE == powerkind ? "none, model only" : powerpath));
+
+  double idlewatts=-1.0;
+  if (idleseconds > 0) {
+    SetCurrentPState(NUMPSTATES - 1);
+    idlewatts=MeasureWatts([idleseconds]() { sleep(idleseconds); });
+    fprintf(stdout, "energy: idle at P%d: %.2fW\n", NUMPSTATES - 1, idlewatts);
+  }
+
+  fprintf(csv, "pstate,multi,mhz,voltage,seconds,work,model_w,model_j_per_unit,measured_w,measured_j_per_unit,measured_above_idle_j_per_unit,source\n");
+  fprintf(stdout, "%-6s %6s %7s %8s %8s %10s %8s %10s %10s\n", "pstate", "MHz", "voltage", "seconds", "model W", "model J/u", "meas. W", "meas. J/u", "above idle");
+
+  std::atomic<bool> oom(false);
+  for (int p = 0; p < NUMPSTATES; p++) {
+    const uint64_t def=Rdmsr(MSRPSTATEDEF0 + p);
+    const double multi=Codec().multi(def);
+    const double voltage=vid2voltage(Codec().vid(def));
+    const double modelw=ModelPowerWatts(multi, voltage, numcores);
+    const double units=(double)work * numcores;
+    if (IsBoostPState(p)) {
+      //boost can't be requested, so there's nothing to time: only the modeled power
+      fprintf(csv, "%d,%.2f,%.0f,%.4f,,,%.3f,,,,,model-only\n", p, multi, multi * DEFAULTREFERENCECLOCK, voltage, modelw);
+      fprintf(stdout, "P%-5d %6.0f %7.4f %8s %8.2f %10s %8s %10s %10s\n", p, multi * DEFAULTREFERENCECLOCK, voltage, "-", modelw, "-", "-", "-", "-");
+      continue;
+    }
+    if (!SetCpbForPState(p) || !SetCurrentPState(p)) {
+      fprintf(stderr, ERRORtext("!! energy: failed to switch to P%d, skipping it") "\n", p);
+      continue;
+    }
+
+    int64_t start=0;
+    int64_t end=0;
+    const double measuredw=MeasureWatts([&]() {
+        start=NowNs();
+        RunOnEachCore([&](int) {
+            void* buf=aligned_alloc(64, KERNELMAXBYTES);
+            if (NULL == buf) {
+              oom.store(true);
+              return;
+            }
+            for (int r = 0; r < work; r++) {
+              for (const int k : kernels) {
+                stresskernels[k].fn(buf, stresskernels[k].bytes, stresskernels[k].rounds);
+              }
+            }
+            free(buf);
+            });
+        end=NowNs();
+        });
+    if (oom.load()) {
+      fclose(csv);
+      SetCpb(cpbwas);
+      SetCurrentPState(initialpstate);
+      fprintf(stderr, ERRORtext("!! energy: out of memory") "\n");
+      return 3;
+    }
+    const double seconds=(end - start) / 1e9;
+    const double modeljpu=modelw * seconds / units;
+    const double measjpu=(measuredw >= 0 ? measuredw * seconds / units : -1.0);
+    const double abovejpu=((measuredw >= 0) && (idlewatts >= 0) ? (measuredw - idlewatts) * seconds / units : -1.0);
+    fprintf(csv, "%d,%.2f,%.0f,%.4f,%.3f,%.0f,%.3f,%.5f,", p, multi, multi * DEFAULTREFERENCECLOCK, voltage, seconds, units, modelw, modeljpu);
+    if (measuredw >= 0) {
+      fprintf(csv, "%.3f,%.5f,", measuredw, measjpu);
+    } else {
+      fprintf(csv, ",,");
+    }
+    if (abovejpu >= 0) {
+      fprintf(csv, "%.5f,", abovejpu);
+    } else {
+      fprintf(csv, ",");
+    }
+    fprintf(csv, "%s\n", (POWERNONE == powerkind ? "model-only" : powerpath));
+    fflush(csv);
+    fprintf(stdout, "P%-5d %6.0f %7.4f %8.2f %8.2f %10.4f %8.2f %10.4f %10.4f\n", p, multi * DEFAULTREFERENCECLOCK, voltage, seconds,
+        modelw, modeljpu, measuredw, measjpu, abovejpu);
+  }
+
+  fclose(csv);
+  SetCpb(cpbwas);
+  SetCurrentPState(initialpstate);
+  fprintf(stdout, "energy: table written to %s(-1 means not measured)\n", out);
+  return 0;
+}
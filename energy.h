@@ -0,0 +1,9 @@
+#pragma once
+
+//performance-per-watt per P-state: for each requestable P-state, runs a fixed amount of work on all cores and reports joules per unit of work, both from a V^2*f power model and, where the platform exposes it, measured(hwmon energy/power, or the battery's power_supply energy_now/power_now while discharging)
+//options: --work=40 (kernel runs per core) --idle-seconds=5 --out=energy.csv
+//returns the process exit code
+int RunEnergy(const int argc, const char* argv[]);
+
+//modeled dynamic power of numcores busy cores at that multi/voltage, in watts
+double ModelPowerWatts(const double multi, const double voltage, const int numcores);
@@ -0,0 +1,199 @@
+#include "governor.h"
+#include "mumu.h"
+#include "pstate.h"
+#include "boost.h"
+#include "thermal.h"
+#include "cores.h"
+#include "msr.h"
+#include "options.h"
+#include "timing.h"
+#include "telemetry.h"
+
+#include <stdio.h>
+#include <errno.h>
+#include <algorithm> //std::min std::max
+#include <signal.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <sys/signalfd.h>
+
+//the fastest P-state the hardware lets any core run right now(0xc0010061, lowered when hot), hardware numbering; 0 if no core's limit is readable
+static int HardwareLimit() {
+  int limit=0;
+  for (int i = 0; i < NumCores(); i++) {
+    int curlimit, maxval;
+    if (GetCorePStateLimit(Core(i).cpu, curlimit, maxval)) {
+      limit=std::max(limit, curlimit);
+    }
+  }
+  return limit;
+}
+
+static void ArmTimer(const int fd, const int64_t intervalns) {
+  struct itimerspec its;
+  its.it_interval.tv_sec = intervalns / 1000000000;
+  its.it_interval.tv_nsec = intervalns % 1000000000;
+  its.it_value = its.it_interval;
+  timerfd_settime(fd, 0, &its, NULL);
+}
+
+int RunGovernor(const int argc, const char* argv[]) {
+  const double target=OptDouble(argc, argv, "--target", 78.0);//MAXTEMP of cpuvary
+  const double hysteresis=OptDouble(argc, argv, "--hysteresis", 2.0);//THRESH of cpuvary
+  const double critical=OptDouble(argc, argv, "--critical", target + 5.0);//straight to the slowest P-state at or above this
+  const int fastest=OptInt(argc, argv, "--fastest", NumBoostStates());//a boost state can't be requested, software P0 is the fastest one that can
+  const int slowest=OptInt(argc, argv, "--slowest", NUMPSTATES - 1);
+  const int64_t fastns=(int64_t)OptInt(argc, argv, "--fast-us", 1000) * 1000;//sampling interval when close to target
+  const int64_t slowns=(int64_t)OptInt(argc, argv, "--slow-ms", 50) * 1000000;//sampling interval when far below target(keeps idle cpu use negligible)
+  const int64_t updelayns=(int64_t)OptInt(argc, argv, "--up-delay-ms", 100) * 1000000;//min. time between steps towards faster P-states, lets the temperature catch up
+
+  if ((fastest < 0) || (slowest >= NUMPSTATES) || (fastest > slowest) || (hysteresis < 0) || (fastns <= 0) || (slowns <= 0)) {
+    fprintf(stderr, ERRORtext("!! governor: invalid options") "\n");
+    return 2;
+  }
+  int caps[2*MAXCPUCORES];
+  const int numcaps=OptIntList(argc, argv, "--cap", caps, 2*MAXCPUCORES);
+  if ((NULL != OptValue(argc, argv, "--cap")) && ((numcaps <= 0) || (0 != numcaps % 2))) {
+    fprintf(stderr, ERRORtext("!! governor: --cap wants cpu:P pairs eg. --cap=3:4,2:2") "\n");
+    return 2;
+  }
+  for (int i = 0; i + 1 < numcaps; i += 2) {
+    if ((caps[i] < 0) || (caps[i] >= MAXCPUCORES)) {
+      fprintf(stderr, ERRORtext("!! governor: no such cpu %d") "\n", caps[i]);
+      return 2;
+    }
+    SetCorePStateCap(caps[i], caps[i+1]);
+    fprintf(stdout, "governor: cpu%d capped at P%d\n", caps[i], CorePStateCap(caps[i]));
+  }
+  if (!ThermalOpen()) {
+    pERR("governor: no temperature source(k10temp hwmon or pci D18F3xA4)");
+    return 3;
+  }
+  fprintf(stdout, "governor: temperature from %s, target:%.1f hysteresis:%.1f critical:%.1f P%d..P%d\n",
+      ThermalSource(), target, hysteresis, critical, fastest, slowest);
+
+  //SIGINT/SIGTERM/SIGHUP come in through epoll too, so we can put back the P-state we started with
+  sigset_t sigs;
+  sigemptyset(&sigs);
+  sigaddset(&sigs, SIGINT);
+  sigaddset(&sigs, SIGTERM);
+  sigaddset(&sigs, SIGHUP);
+  sigprocmask(SIG_BLOCK, &sigs, NULL);
+  const int sigfd=signalfd(-1, &sigs, SFD_CLOEXEC);
+  const int timerfd=timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+  const int hotplugfd=HotplugOpen();//optional
+  const int epfd=epoll_create1(EPOLL_CLOEXEC);
+  if ((-1 == sigfd) || (-1 == timerfd) || (-1 == epfd)) {
+    pERR("governor: failed to set up the event loop");
+    return 3;
+  }
+  const int fds[]={sigfd, timerfd, hotplugfd};
+  for (const int fd : fds) {
+    if (-1 == fd) {
+      continue;
+    }
+    struct epoll_event ev;
+    ev.events=EPOLLIN;
+    ev.data.fd=fd;
+    epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev);
+  }
+
+  const int initialpstate=GetCurrentPState();
+  int pstate=std::min(slowest, std::max(fastest, initialpstate));
+  if (!SetCurrentPState(pstate)) {
+    fprintf(stderr, ERRORtext("!! governor: failed to switch to P%d, starting from P%d") "\n", pstate, initialpstate);
+    pstate=initialpstate;
+  }
+  int64_t lastchange=NowNs();
+  int64_t interval=fastns;
+  ArmTimer(timerfd, interval);
+
+  bool running=true;
+  while (running) {
+    struct epoll_event events[4];
+    const int n=epoll_wait(epfd, events, 4, -1);
+    for (int e = 0; e < n; e++) {
+      const int fd=events[e].data.fd;
+      if (fd == sigfd) {
+        struct signalfd_siginfo si;
+        if (sizeof(si) == read(sigfd, &si, sizeof(si))) {
+          fprintf(stdout, "governor: got signal %u, exiting\n", si.ssi_signo);
+        }
+        running=false;
+      } else if (fd == hotplugfd) {
+        int cpu=-1;
+        bool online=false;
+        bool changed=false;
+        while (HotplugRead(hotplugfd, cpu, online)) {
+          if (!online) {
+            MsrClose(cpu);
+          }
+          changed=true;
+        }
+        if (changed) {
+          DiscoverTopology();
+          MsrOpenAll();
+          if (!SetCurrentPState(pstate)) {//so a cpu that just came online follows the governor too
+            fprintf(stderr, ERRORtext("!! governor: failed to put the cores back to P%d after a hotplug") "\n", pstate);
+          }
+        }
+      } else if (fd == timerfd) {
+        uint64_t expirations;
+        if (sizeof(expirations) != read(timerfd, &expirations, sizeof(expirations))) {
+          continue;
+        }
+        double temp;
+        if (!ReadTemperature(temp)) {
+          pERR("governor: failed to read the temperature");
+          continue;
+        }
+        TelemetryTemperature(temp);
+        const int64_t now=NowNs();
+        int wanted=pstate;
+        if (temp >= critical) {
+          wanted=slowest;
+        } else if (temp >= target) {
+          wanted=std::min(slowest, pstate + 1);//higher index is slower
+        } else if ((temp <= target - hysteresis) && (now - lastchange >= updelayns)) {
+          wanted=std::max(fastest, pstate - 1);
+        }
+        //the hardware clamps to its own limit anyway, asking for faster would just time out waiting for a P-state it won't run
+        const int limit=HardwareLimit();
+        wanted=std::max(wanted, limit);
+        if (wanted != pstate) {
+          if (SetCurrentPState(wanted)) {
+            fprintf(stdout, "governor: %.1fC P%d -> P%d\n", temp, pstate, wanted);
+            pstate=wanted;
+            lastchange=now;
+          } else {
+            fprintf(stderr, ERRORtext("!! governor: %.1fC failed to switch P%d -> P%d, staying at P%d") "\n", temp, pstate, wanted, pstate);
+          }
+        }
+        //sample fast only while it matters: near the target or while not at the fastest allowed P-state yet
+        const int64_t newinterval=((temp >= target - 2*hysteresis - 1.0) || (pstate != std::max(fastest, limit))) ? fastns : slowns;
+        if (newinterval != interval) {
+          interval=newinterval;
+          ArmTimer(timerfd, interval);
+        }
+      }
+    }
+    if ((-1 == n) && (EINTR != errno)) {
+      pERR("governor: epoll_wait failed");
+      break;
+    }
+  }
+
+  fprintf(stdout, "governor: restoring P%d\n", initialpstate);
+  for (int i = 0; i + 1 < numcaps; i += 2) {
+    SetCorePStateCap(caps[i], 0);
+  }
+  SetCurrentPState(initialpstate);
+  close(epfd);
+  close(timerfd);
+  close(sigfd);
+  if (-1 != hotplugfd) {
+    close(hotplugfd);
+  }
+  return 0;
+}
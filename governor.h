@@ -0,0 +1,8 @@
+#pragma once
+
+//closed-loop thermal P-state governor: stays running, samples the core temperature and picks the fastest P-state the thermal budget allows(replaces the external cpuvary polling script)
+//options: --target=78 --hysteresis=2 --critical=<target+5> --fastest=<NumBoostStates, ie. software P0> --slowest=7 --fast-us=1000 --slow-ms=50 --up-delay-ms=100
+//  never asks for a P-state faster than the hardware limit(0xc0010061); a failed switch keeps the previous P-state
+//  --cap=cpu:P,... keeps those cpus at P or slower whatever the governor picks, eg. --cap=3:4 for background work on cpu3
+//returns the process exit code
+int RunGovernor(const int argc, const char* argv[]);
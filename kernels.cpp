@@ -0,0 +1,114 @@
+#include "kernels.h"
+
+#include <emmintrin.h> //SSE2, which every x86_64 has
+
+static inline uint64_t Mix(uint64_t h, const uint64_t v) {
+  h ^= v;
+  h *= 0x100000001b3ULL;//FNV-1a prime
+  return h ^ (h >> 29);
+}
+
+uint64_t KernelFp(void* buf, const size_t bytes, const int rounds) {
+  double* x=(double*)buf;
+  const size_t n=(bytes / sizeof(double)) & ~(size_t)1;//pairs for the 128bit registers
+  for (size_t i = 0; i < n; i++) {
+    x[i]=1.0 + (double)(i % 1000) * 1e-3;
+  }
+  const __m128d a=_mm_set1_pd(0.9999999);
+  const __m128d b=_mm_set1_pd(1e-7);
+  for (int r = 0; r < rounds; r++) {
+    for (size_t i = 0; i < n; i += 2) {
+      __m128d v=_mm_load_pd(x + i);
+      v=_mm_add_pd(_mm_mul_pd(v, a), b);//stays around 1.0, never over/underflows
+      v=_mm_mul_pd(_mm_sqrt_pd(v), _mm_sqrt_pd(v));
+      _mm_store_pd(x + i, v);
+    }
+  }
+  uint64_t h=0xcbf29ce484222325ULL;
+  for (size_t i = 0; i < n; i++) {
+    uint64_t bits;
+    __builtin_memcpy(&bits, x + i, sizeof(bits));
+    h=Mix(h, bits);
+  }
+  return h;
+}
+
+uint64_t KernelInt(void* buf, const size_t bytes, const int rounds) {
+  uint64_t* x=(uint64_t*)buf;
+  const size_t n=bytes / sizeof(uint64_t);
+  for (size_t i = 0; i < n; i++) {
+    x[i]=0x9e3779b97f4a7c15ULL * (i + 1);
+  }
+  for (int r = 0; r < rounds; r++) {
+    for (size_t i = 0; i < n; i++) {
+      uint64_t v=x[i];
+      v ^= v >> 31;
+      v *= 0xbf58476d1ce4e5b9ULL;
+      v ^= v >> 27;
+      v += v / ((i | 1) + r);//keeps the divider busy too
+      x[i]=v;
+    }
+  }
+  uint64_t h=0xcbf29ce484222325ULL;
+  for (size_t i = 0; i < n; i++) {
+    h=Mix(h, x[i]);
+  }
+  return h;
+}
+
+uint64_t KernelStream(void* buf, const size_t bytes, const int rounds) {
+  uint64_t* x=(uint64_t*)buf;
+  const size_t n=bytes / sizeof(uint64_t);
+  for (size_t i = 0; i < n; i++) {
+    x[i]=i;
+  }
+  for (int r = 0; r < rounds; r++) {
+    for (size_t i = 0; i < n; i++) {
+      x[i]=x[i] * 3 + x[n - 1 - i] + r;
+    }
+  }
+  uint64_t h=0xcbf29ce484222325ULL;
+  for (size_t i = 0; i < n; i += 8) {//one per cache line is enough, every element depends on the others anyway
+    h=Mix(h, x[i]);
+  }
+  return h;
+}
+
+uint64_t KernelChase(void* buf, const size_t bytes, const int rounds) {
+  //one entry per cache line, linked into a single random cycle(Sattolo's shuffle) with a fixed seed
+  const size_t stride=64 / sizeof(uint64_t);
+  uint64_t* x=(uint64_t*)buf;
+  const size_t n=bytes / 64;
+  for (size_t i = 0; i < n; i++) {
+    x[i * stride]=i;
+  }
+  uint64_t seed=0x2545f4914f6cdd1dULL;
+  for (size_t i = n - 1; i > 0; i--) {
+    seed ^= seed << 13;
+    seed ^= seed >> 7;
+    seed ^= seed << 17;
+    const size_t j=seed % i;
+    const uint64_t t=x[i * stride];
+    x[i * stride]=x[j * stride];
+    x[j * stride]=t;
+  }
+  uint64_t h=0xcbf29ce484222325ULL;
+  uint64_t p=0;
+  for (int r = 0; r < rounds; r++) {
+    for (size_t i = 0; i < n; i++) {
+      p=x[p * stride];
+      h += p;
+    }
+  }
+  return Mix(h, p);
+}
+
+const KernelInfo stresskernels[NUMSTRESSKERNELS]={
+  //name       fn            bytes           rounds  workunits(= elements*rounds)
+  {"fp-l1",     KernelFp,     KERNELL1BYTES,  4096,   (KERNELL1BYTES / 8) * 4096ULL},
+  {"fp-l2",     KernelFp,     KERNELL2BYTES,  128,    (KERNELL2BYTES / 8) * 128ULL},
+  {"int-l1",    KernelInt,    KERNELL1BYTES,  1024,   (KERNELL1BYTES / 8) * 1024ULL},
+  {"int-l2",    KernelInt,    KERNELL2BYTES,  32,     (KERNELL2BYTES / 8) * 32ULL},
+  {"stream-ram", KernelStream, KERNELRAMBYTES, 4,      (KERNELRAMBYTES / 8) * 4ULL},
+  {"chase-ram", KernelChase,  KERNELRAMBYTES, 2,      (KERNELRAMBYTES / 64) * 2ULL},
+};
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <inttypes.h>
+#include <stddef.h>
+
+//deterministic compute kernels, shared by the stress, search and bench modes
+//each one fills its buffer from a fixed seed, works on it and returns a checksum of the result: a healthy core always gets the bit-identical checksum, so any difference is a computation error(eg. too low a voltage)
+//buf must be 64 byte aligned and at least bytes long; rounds scales the amount of work linearly
+
+#define KERNELL1BYTES (16*1024) //fits the 64KB L1D
+#define KERNELL2BYTES (512*1024) //fits the 1MB per core L2 of family 12h
+#define KERNELRAMBYTES (16*1024*1024) //well past any cache
+#define KERNELMAXBYTES KERNELRAMBYTES
+
+typedef uint64_t (*KernelFn)(void* buf, const size_t bytes, const int rounds);
+
+uint64_t KernelFp(void* buf, const size_t bytes, const int rounds);//SSE2 packed double mul/add/sqrt
+uint64_t KernelInt(void* buf, const size_t bytes, const int rounds);//64bit multiply/shift/xor/divide hash mixing
+uint64_t KernelStream(void* buf, const size_t bytes, const int rounds);//read-modify-write sweeps, bandwidth bound
+uint64_t KernelChase(void* buf, const size_t bytes, const int rounds);//dependent loads through a random cyclic permutation, latency bound
+
+struct KernelInfo {
+  const char* name;
+  KernelFn fn;
+  size_t bytes;
+  int rounds; //so that one call does a comparable amount of work(some tens of ms on a Llano core)
+  uint64_t workunits; //units of work done by one call, eg. for throughput = workunits/seconds
+};
+
+//the mix used by stress: FP and integer in L1 and L2 plus memory-bound sweeps, like prime95 Blend does with its FFT sizes
+#define NUMSTRESSKERNELS 6
+extern const KernelInfo stresskernels[NUMSTRESSKERNELS];
@@ -0,0 +1,107 @@
+#include "latency.h"
+#include "mumu.h"
+#include "pstate.h"
+#include "cores.h"
+#include "boost.h"
+#include "options.h"
+
+#include <stdio.h>
+#include <vector>
+#include <algorithm> //std::sort
+
+#define NUMHISTBUCKETS 16 //power of 2 buckets: <1us, <2us, <4us ... >=16ms
+
+static int HistBucket(const int64_t ns) {
+  int b=0;
+  for (int64_t limit = 1000; (ns >= limit) && (b < NUMHISTBUCKETS - 1); limit *= 2) {
+    b++;
+  }
+  return b;
+}
+
+int RunLatency(const int argc, const char* argv[]) {
+  const int iterations=OptInt(argc, argv, "--iterations", 200);
+  const int64_t timeoutns=(int64_t)OptInt(argc, argv, "--timeout-us", PSTATETRANSITIONTIMEOUTNS / 1000) * 1000;
+  if ((iterations <= 0) || (timeoutns <= 0)) {
+    fprintf(stderr, ERRORtext("!! latency: invalid options") "\n");
+    return 2;
+  }
+  const int numcores=NumCores();
+  const int initialpstate=GetCurrentPState();
+  const int numswpstates=NUMPSTATES - NumBoostStates();//boost states can't be requested, see boost.h
+
+  //samples[from][to][core], only written by that core's thread
+  static std::vector<int64_t> samples[NUMPSTATES][NUMPSTATES][MAXCPUCORES];
+  int failures[MAXCPUCORES]={0};
+  uint64_t hist[MAXCPUCORES][NUMHISTBUCKETS]={{0}};
+
+  fprintf(stdout, "latency: %d cores, %d requestable P-states(P%d..P%d, hardware numbering), %d iterations per pair, timeout %.1fus\n",
+      numcores, numswpstates, SwToHw(0), SwToHw(numswpstates - 1), iterations, timeoutns / 1000.0);
+  RunOnEachCore([&](int i) {
+      const int cpu=Core(i).cpu;
+      for (int from = 0; from < numswpstates; from++) {
+        for (int to = 0; to < numswpstates; to++) {
+          if (from == to) {
+            continue;
+          }
+          std::vector<int64_t>& v=samples[from][to][i];
+          v.reserve(iterations);
+          for (int it = 0; it < iterations; it++) {
+            if (SwitchCorePState(cpu, from, timeoutns) < 0) {
+              failures[i]++;
+              continue;
+            }
+            const int64_t ns=SwitchCorePState(cpu, to, timeoutns);
+            if (ns < 0) {
+              failures[i]++;
+              continue;
+            }
+            v.push_back(ns);
+            hist[i][HistBucket(ns)]++;
+          }
+        }
+      }
+      });
+
+  fprintf(stdout, "%-8s %-5s %10s %10s %10s\n", "from->to", "cpu", "min(us)", "median(us)", "p99(us)");
+  for (int from = 0; from < numswpstates; from++) {
+    for (int to = 0; to < numswpstates; to++) {
+      if (from == to) {
+        continue;
+      }
+      for (int i = 0; i < numcores; i++) {
+        std::vector<int64_t>& v=samples[from][to][i];
+        if (v.empty()) {
+          fprintf(stdout, "P%d->P%d   %-5d %10s %10s %10s\n", SwToHw(from), SwToHw(to), Core(i).cpu, "-", "-", "-");
+          continue;
+        }
+        std::sort(v.begin(), v.end());
+        fprintf(stdout, "P%d->P%d   %-5d %10.1f %10.1f %10.1f\n", SwToHw(from), SwToHw(to), Core(i).cpu,
+            v.front() / 1000.0, v[v.size() / 2] / 1000.0, v[(v.size() * 99) / 100] / 1000.0);
+      }
+    }
+  }
+
+  fprintf(stdout, "histogram of all transitions(us):\n");
+  for (int i = 0; i < numcores; i++) {
+    fprintf(stdout, "  cpu%d (%d failed/timed out):\n", Core(i).cpu, failures[i]);
+    for (int b = 0; b < NUMHISTBUCKETS; b++) {
+      if (0 == hist[i][b]) {
+        continue;
+      }
+      if (NUMHISTBUCKETS - 1 == b) {
+        fprintf(stdout, "    >=%-7d %8" PRIu64 "\n", 1 << (b - 1), hist[i][b]);
+      } else {
+        fprintf(stdout, "    <%-8d %8" PRIu64 "\n", 1 << b, hist[i][b]);
+      }
+    }
+  }
+
+  SetCurrentPState(initialpstate);
+  for (int i = 0; i < numcores; i++) {
+    if (failures[i] > 0) {
+      return 1;
+    }
+  }
+  return 0;
+}
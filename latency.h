@@ -0,0 +1,6 @@
+#pragma once
+
+//P-state transition latency mode: switches every core between every pair of requestable P-states many times and reports write-to-acknowledge latency(min/median/p99 per pair and core, plus a histogram per core); labelled in hardware numbering like the other modes
+//options: --iterations=200 --timeout-us=20000
+//returns the process exit code
+int RunLatency(const int argc, const char* argv[]);
@@ -0,0 +1,84 @@
+#include "monitor.h"
+#include "mumu.h"
+#include "codec.h"
+#include "msr.h"
+#include "cores.h"
+#include "pstate.h"
+#include "boost.h"
+#include "options.h"
+#include "timing.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h> //usleep
+
+#define MSRTSC 0x10
+#define MSRMPERF 0xe7 //counts at the TSC(P0) rate while the core is in C0
+#define MSRAPERF 0xe8 //counts at the actual core clock while in C0
+
+struct MonitorSample {
+  int64_t ns;
+  uint64_t tsc;
+  uint64_t mperf;
+  uint64_t aperf;
+  uint64_t control; //0xc0010062, the requested software P-state
+  uint64_t cofvid; //0xc0010071, the running P-state and its fid/did
+  bool ok;
+};
+
+//one sample of every core, each read on its own core so TSC/MPERF/APERF are read back to back without IPIs
+static void SampleAll(MonitorSample* samples) {
+  RunOnEachCore([samples](int i) {
+      const int cpu=Core(i).cpu;
+      MonitorSample& s=samples[i];
+      s.ok = MsrRead(cpu, MSRTSC, s.tsc);
+      s.ok = MsrRead(cpu, MSRMPERF, s.mperf) && s.ok;
+      s.ok = MsrRead(cpu, MSRAPERF, s.aperf) && s.ok;
+      s.ns = NowNs();
+      s.ok = MsrRead(cpu, MSRPSTATECONTROL, s.control) && s.ok;
+      s.ok = MsrRead(cpu, MSRCOFVIDSTATUS, s.cofvid) && s.ok;
+      });
+}
+
+int RunMonitor(const int argc, const char* argv[]) {
+  const int intervalms=OptInt(argc, argv, "--interval-ms", 1000);
+  const int count=OptInt(argc, argv, "--count", 0);
+  if ((intervalms <= 0) || (count < 0)) {
+    fprintf(stderr, ERRORtext("!! monitor: invalid options") "\n");
+    return 2;
+  }
+
+  MonitorSample prev[MAXCPUCORES];
+  MonitorSample cur[MAXCPUCORES];
+  const int numcores=NumCores();
+  SampleAll(prev);
+  const int64_t start=prev[0].ns;
+
+  fprintf(stdout, "monitor: %d cores every %dms; per core: effective MHz / running P-state's MHz, running<-requested P-state(hardware numbering, B for a boost state), utilization\n", numcores, intervalms);
+  for (int n = 0; (0 == count) || (n < count); n++) {
+    usleep(intervalms * 1000);
+    SampleAll(cur);
+    fprintf(stdout, "%8.2fs", (cur[0].ns - start) / 1e9);
+    for (int i = 0; i < numcores; i++) {
+      if (!cur[i].ok || !prev[i].ok) {
+        fprintf(stdout, " | cpu%d: read failed", Core(i).cpu);
+        continue;
+      }
+      const double dtsc=(double)(cur[i].tsc - prev[i].tsc);
+      const double dmperf=(double)(cur[i].mperf - prev[i].mperf);
+      const double daperf=(double)(cur[i].aperf - prev[i].aperf);
+      const double dns=(double)(cur[i].ns - prev[i].ns);
+      const double tscmhz=(dns > 0 ? dtsc * 1000.0 / dns : 0.0);
+      const double effmhz=(dmperf > 0 ? daperf / dmperf * tscmhz : 0.0);//0 if the core slept through the whole interval
+      const double util=(dtsc > 0 ? 100.0 * dmperf / dtsc : 0.0);
+      const int running=GetBits(cur[i].cofvid, 16, 3);
+      const int requested=SwToHw(GetBits(cur[i].control, 0, 3));
+      const double runningmhz=Codec().multi(cur[i].cofvid) * DEFAULTREFERENCECLOCK;//CurCpuFid/Did, same encoding as in the P-state definitions
+      fprintf(stdout, " | cpu%d %5.0f/%4.0fMHz %s%d<-P%d %5.1f%%", Core(i).cpu, effmhz, runningmhz, (IsBoostPState(running) ? "B" : "P"), running, requested, util);
+    }
+    fprintf(stdout, "\n");
+    fflush(stdout);
+    memcpy(prev, cur, sizeof(prev));
+  }
+  return 0;
+}
@@ -0,0 +1,6 @@
+#pragma once
+
+//effective-frequency monitor: samples TSC/MPERF/APERF and the P-state registers of every core at a fixed rate and prints the delivered frequency(APERF/MPERF times the TSC rate), the P-state being requested vs the one running, and utilization(MPERF/TSC)
+//options: --interval-ms=1000 --count=0(0 is forever)
+//returns the process exit code
+int RunMonitor(const int argc, const char* argv[]);
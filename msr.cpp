@@ -0,0 +1,116 @@
+#include "msr.h"
+#include "cores.h"
+
+#include <stdio.h> //snprintf
+#include <errno.h>
+#include <unistd.h> //for pread, pwrite, close
+#include <fcntl.h> //for O_RDWR
+
+//the msr driver: /dev/cpu/N/msr, where the register index is the file offset
+class DevMsrBackend : public MsrBackend {
+  int fd[MAXCPUCORES];
+
+public:
+
+  DevMsrBackend() {
+    for (int i = 0; i < MAXCPUCORES; i++) {
+      fd[i]=-1;
+    }
+  }
+  const char* Name() const override { return "/dev/cpu/N/msr"; }
+  bool Open(const int cpu) override;
+  void Close(const int cpu) override;
+  bool Read(const int cpu, const uint32_t regIndex, uint64_t& value) override;
+  bool Write(const int cpu, const uint32_t regIndex, const uint64_t value) override;
+};
+
+static DevMsrBackend devbackend;//all closed before main() even starts, so there's no lazy init to race on from the per-core threads
+static MsrBackend* backend=&devbackend;
+
+void SetMsrBackend(MsrBackend* b) {
+  backend=(NULL == b ? &devbackend : b);
+}
+
+const char* MsrBackendName() {
+  return backend->Name();
+}
+
+bool DevMsrBackend::Open(const int cpu) {
+  if ((cpu < 0) || (cpu >= MAXCPUCORES)) {
+    errno=EINVAL;
+    return false;
+  }
+  if (-1 != fd[cpu]) {
+    return true;//already open
+  }
+
+  char path[255]= "\0";
+  int ret=snprintf(path, sizeof(path), "/dev/cpu/%d/msr", cpu);
+  if ((ret < 0) || (ret >= (int)sizeof(path))) {
+    errno=ENAMETOOLONG;
+    return false;
+  }
+
+  int newfd = open(path, O_RDWR | O_CLOEXEC);
+  if ((-1 == newfd) && ((EACCES == errno) || (EPERM == errno))) {
+    newfd = open(path, O_RDONLY | O_CLOEXEC);//enough for just showing the current state; writes will then fail with EBADF
+  }
+  if (-1 == newfd) {
+    return false;
+  }
+  fd[cpu]=newfd;
+  return true;
+}
+
+void DevMsrBackend::Close(const int cpu) {
+  if ((cpu < 0) || (cpu >= MAXCPUCORES) || (-1 == fd[cpu])) {
+    return;
+  }
+  close(fd[cpu]);
+  fd[cpu]=-1;
+}
+
+bool DevMsrBackend::Read(const int cpu, const uint32_t regIndex, uint64_t& value) {
+  if (!Open(cpu)) {
+    return false;
+  }
+  return (sizeof(value) == pread(fd[cpu], &value, sizeof(value), regIndex));//read 8 bytes
+}
+
+bool DevMsrBackend::Write(const int cpu, const uint32_t regIndex, const uint64_t value) {
+  if (!Open(cpu)) {
+    return false;
+  }
+  return (sizeof(value) == pwrite(fd[cpu], &value, sizeof(value), regIndex));
+}
+
+bool MsrOpen(const int cpu) {
+  return backend->Open(cpu);
+}
+
+bool MsrOpenAll() {
+  for (int i = 0; i < NumCores(); i++) {
+    if (!MsrOpen(Core(i).cpu)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void MsrClose(const int cpu) {
+  backend->Close(cpu);
+}
+
+void MsrCloseAll() {
+  for (int i = 0; i < MAXCPUCORES; i++) {
+    MsrClose(i);
+  }
+}
+
+bool MsrRead(const int cpu, const uint32_t regIndex, uint64_t& value) {
+  return backend->Read(cpu, regIndex, value);
+}
+
+bool MsrWrite(const int cpu, const uint32_t regIndex, const uint64_t value) {
+  return backend->Write(cpu, regIndex, value);
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <inttypes.h> //for uint32_t uint64_t
+
+//persistent per-cpu msr device handles: each /dev/cpu/N/msr is opened once(on first use or via MsrOpenAll) and kept open for the whole process, so every register access after that is just one pread/pwrite syscall
+//cpu is the logical cpu number(see cores.h)
+//all of these return false on failure(errno is left as set by the failing syscall) and never print anything
+
+bool MsrOpen(const int cpu);
+bool MsrOpenAll();//opens all discovered online cores(DiscoverTopology() first), call this before touching the msrs from multiple threads
+void MsrClose(const int cpu);
+void MsrCloseAll();
+
+bool MsrRead(const int cpu, const uint32_t regIndex, uint64_t& value);
+bool MsrWrite(const int cpu, const uint32_t regIndex, const uint64_t value);
+
+//where the functions above go: the msr driver by default, or eg. the simulated cpu(see simcpu.h)
+//implementations must be safe to call from one thread per core at the same time
+class MsrBackend {
+public:
+  virtual ~MsrBackend() {}
+  virtual const char* Name() const = 0;
+  virtual bool Open(const int cpu) = 0;
+  virtual void Close(const int cpu) = 0;
+  virtual bool Read(const int cpu, const uint32_t regIndex, uint64_t& value) = 0;
+  virtual bool Write(const int cpu, const uint32_t regIndex, const uint64_t value) = 0;
+};
+
+//switch backends before opening anything; NULL goes back to /dev/cpu/N/msr
+void SetMsrBackend(MsrBackend* backend);
+const char* MsrBackendName();
@@ -1,6 +1,9 @@
 #pragma once
 
 #include <inttypes.h> //for uint32_t uint64_t
+#include <stdio.h> //for perror (used by pERR)
+#include <string> //for ExceptionWithMessage
+#include <exception>
 
 struct PStateInfo {
     double multi; //multiplier ( multiply with the reference clock of 100Mhz eg. multi*REFERENCECLOCK)
@@ -22,7 +25,7 @@ struct PStateInfo {
 };
 
 // special divisors for family 0x12 (aka 18 in decimal)
-static const double DIVISORS_12[] = { 1.0, 1.5, 2.0, 3.0, 4.0, 6.0, 8.0, 12.0, 16.0, 0.0 };
+constexpr double DIVISORS_12[] = { 1.0, 1.5, 2.0, 3.0, 4.0, 6.0, 8.0, 12.0, 16.0, 0.0 };
 
 //top voltage, fixed value used for calculating VIDs and stuff, do not change!!!
 #define V155 1.55
@@ -32,7 +35,6 @@ static const double DIVISORS_12[] = { 1.0, 1.5, 2.0, 3.0, 4.0, 6.0, 8.0, 12.0, 1
 #define REFERENCECLOCK DEFAULTREFERENCECLOCK //for my CPU, is the same 100MHz (unused)
 
 #define NUMPSTATES 8
-#define NUMCPUCORES 4 //4 cores, for my CPU
 #define CPUFAMILY 0x12
 #define CPUMODEL 0x1
 #define CPUMINMULTI 1.0
@@ -56,7 +58,7 @@ static const double DIVISORS_12[] = { 1.0, 1.5, 2.0, 3.0, 4.0, 6.0, 8.0, 12.0, 1
 #define CPUMINVIDunderclocked 67 //multi 8x, fid 0, did 2 vid 67, pstate7(lowest) underclocked
 #define CPUMINVOLTAGEunderclocked 0.7125 //1.55 - 67*0.0125 = .7125
 
-const struct PStateInfo  __attribute__((unused)) bootdefaults_psi[NUMPSTATES]={//XXX: fyi only, do not use this!
+constexpr struct PStateInfo  __attribute__((unused)) bootdefaults_psi[NUMPSTATES]={//XXX: fyi only, do not use this!
   {23.0, 1.325, 18}, //P0, boost  aka B0
   {14.0, 1.0625, 39}, //P1, normal; if boost is B0(instead of P0) then this is P0 not P1, thus there's no P7 in this convention scenario!
   {13.0, 1.025, 42},
@@ -67,7 +69,7 @@ const struct PStateInfo  __attribute__((unused)) bootdefaults_psi[NUMPSTATES]={/
   {8.0, 0.925, 50} //P7, normal; or P6 if boost is B0
 };
 //bootdefaults_psi;//prevent -Wunused-variable warning; nvm, got statement has no effect  warning. What I actually need is:  __attribute__((unused))  src: https://stackoverflow.com/questions/15053776/how-do-you-disable-the-unused-variable-warnings-coming-out-of-gcc
-const struct PStateInfo allpsi[NUMPSTATES]={//stable underclocking for my CPU:
+constexpr struct PStateInfo allpsi[NUMPSTATES]={//stable underclocking for my CPU(validated and encoded at compile time, see profile.h):
   //to see how to compute VID (the last value, that is) seek to the beginning of this file! shift+3 on this word: VID  (in vim) and press 'n' one more time
 //  {30.0, 1.3250, 18}, //P0, boost
 //  {30.0, 1.3250, 18}, //P1, //96degC and seg fault during kernel build! - DON'T do this! might work with cpuvary! #added3  sort of untested in linux - unsure if it(boost) ever activated! looks like this uses 85Watts from PSU when 100% cpu usage during gcc compiling, and max 23Watts when idle.; unde.txt
@@ -94,7 +96,7 @@ const struct PStateInfo allpsi[NUMPSTATES]={//stable underclocking for my CPU:
 //  {8.0, 0.7125, 67} //P7, normal
 };
 
-template <typename T> uint32_t GetBits(T value, unsigned char offset, unsigned char numBits) {
+template <typename T> constexpr uint32_t GetBits(T value, unsigned char offset, unsigned char numBits) {
     const T mask = (((T)1 << numBits) - (T)1); // 2^numBits - 1; after right-shift
     return (uint32_t)((value >> offset) & mask);
 }
@@ -104,13 +106,17 @@ template <typename T> void SetBits(T& value, uint32_t bits, unsigned char offset
     value = (value & ~mask) | (((T)bits << offset) & mask);
 }
 
+//keeps its own copy of the message: what() used to point into the constructor's argument, which was gone by the time anyone caught it
 class ExceptionWithMessage: public std::exception {
-    const char* what;
+    std::string msg;
 
 public:
 
-    ExceptionWithMessage(std::string msg) {
-        this->what = msg.c_str();
+    ExceptionWithMessage(std::string msg) : msg(msg) {
+    }
+
+    const char* what() const noexcept override {
+        return msg.c_str();
     }
 };
 
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <string.h> //strcmp strncmp strlen
+#include <stdlib.h> //strtod
+
+//tiny "--name" / "--name=value" command line helpers, shared by all the modes
+
+inline bool HasArg(const int argc, const char* argv[], const char* arg) {
+  for (int i = 1; i < argc; i++) {
+    if (0 == strcmp(arg, argv[i])) {
+      return true;
+    }
+  }
+  return false;
+}
+
+//returns what follows "name=" eg. OptValue(argc, argv, "--target") for "--target=78", NULL if not given
+inline const char* OptValue(const int argc, const char* argv[], const char* name) {
+  const size_t len=strlen(name);
+  for (int i = 1; i < argc; i++) {
+    if ((0 == strncmp(name, argv[i], len)) && ('=' == argv[i][len])) {
+      return argv[i] + len + 1;
+    }
+  }
+  return NULL;
+}
+
+inline double OptDouble(const int argc, const char* argv[], const char* name, const double def) {
+  const char* v=OptValue(argc, argv, name);
+  return (NULL == v ? def : strtod(v, NULL));
+}
+
+inline int OptInt(const int argc, const char* argv[], const char* name, const int def) {
+  const char* v=OptValue(argc, argv, name);
+  return (NULL == v ? def : (int)strtol(v, NULL, 10));
+}
+
+//comma separated ints eg. "--cpus=1,3" or, with pairs, "--cap=3:2,1:4" (a ':' is just another separator), at most max of them
+//returns how many were stored in out, -1 if not given or malformed
+inline int OptIntList(const int argc, const char* argv[], const char* name, int* out, const int max) {
+  const char* v=OptValue(argc, argv, name);
+  if (NULL == v) {
+    return -1;
+  }
+  int n=0;
+  while (('\0' != *v) && (n < max)) {
+    char* end=NULL;
+    out[n++]=(int)strtol(v, &end, 10);
+    if (end == v) {
+      return -1;
+    }
+    v=end;
+    if ((',' == *v) || (':' == *v)) {
+      v++;
+    }
+  }
+  return n;
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include "mumu.h"
+
+#include <algorithm> //std::max std::min, constexpr since c++14
+
+//P-state profiles(allpsi, bootdefaults_psi) are constexpr data: their FID/DID/VID encoding, range checks and the packed MSR low word are all computed at compile time
+//a bad row(eg. a multi that family 12h can't do, or a VID that doesn't match its voltage) fails the build instead of an assert at apply time
+//the kernel patch's allpsi(with datalo) can be generated from the same data: amdmsrt4myZ575 kerneltable
+
+#define PSTATELOWMASK 0xffffULL //CpuDid[3:0] CpuFid[8:4] CpuVid[15:9]
+
+void constexpr FindFraction(double value, const double* divisors,
+    int& numerator, int& divisorIndex,
+    const int minNumerator, const int maxNumerator) {
+  // limitations: non-negative value and divisors
+
+  // count the null-terminated and ascendingly ordered divisors
+  int numDivisors = 0;
+  for (; divisors[numDivisors] > 0; numDivisors++) { }
+
+  // make sure the value is in a valid range
+  value = std::max(minNumerator / divisors[numDivisors-1], std::min(maxNumerator / divisors[0], value));
+
+  // search the best-matching combo
+  double bestValue = -1.0; // numerator / divisors[divisorIndex]
+  for (int i = 0; i < numDivisors; i++) {
+    const double d = divisors[i];
+    const int n = std::max(minNumerator, std::min(maxNumerator, (int)(value * d)));
+    const double myValue = n / d;
+
+    if (myValue <= value && myValue > bestValue) {
+      numerator = n;
+      divisorIndex = i;
+      bestValue = myValue;
+
+      if (bestValue == value)
+        break;
+    }
+  }
+}
+
+//one P-state row, encoded for the P-state definition msr(0xc0010064 + numpstate)
+struct PStateWord {
+  int fid;
+  int did;
+  int vid;
+  uint64_t lo; //fid/did/vid packed into bits 15:0, the rest of the register is kept as it is
+  bool valid; //every check below passed
+};
+
+constexpr int ConstexprVoltage2Vid(const double voltage) {
+  return (int)(V155 / CPUVIDSTEP) - (int)(voltage / CPUVIDSTEP + 0.5);//same rounding as voltage2vid()
+}
+
+constexpr PStateWord EncodePState(const PStateInfo& p) {
+  const int minNumerator = 16; // numerator: 0x10 = 16 as fixed offset
+  const int maxNumerator = 31 + minNumerator; // 5 bits => max 2^5-1 = 31
+  int numerator = 0, divisorIndex = 0;
+  FindFraction(p.multi, DIVISORS_12, numerator, divisorIndex, minNumerator, maxNumerator);
+
+  PStateWord w = { numerator - minNumerator, divisorIndex, p.VID, 0, false };
+  w.lo = ((uint64_t)w.vid << 9) | ((uint64_t)w.fid << 4) | (uint64_t)w.did;
+  w.valid = (p.multi >= CPUMINMULTIunderclocked) && (p.multi <= CPUMAXMULTIunderclocked)
+    && ((w.fid + 16) / DIVISORS_12[w.did] == p.multi) //exactly representable, not just the nearest lower one
+    && (p.strvid >= CPUMINVOLTAGEunderclocked) && (p.strvid <= V1325)
+    && (p.VID == ConstexprVoltage2Vid(p.strvid))
+    && (p.VID >= CPUMAXVIDunderclocked) && (p.VID <= CPUMINVIDunderclocked);
+  return w;
+}
+
+//index of the first invalid row, or of the first row that's faster/higher voltage than the one before it(P0 must be the fastest), -1 if the table is fine
+constexpr int FirstBadPStateRow(const PStateInfo (&table)[NUMPSTATES]) {
+  for (int i = 0; i < NUMPSTATES; i++) {
+    if (!EncodePState(table[i]).valid) {
+      return i;
+    }
+    if ((i > 0) && ((table[i].multi > table[i-1].multi) || (table[i].VID < table[i-1].VID))) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+//the build error names the offending row as the template argument, eg. BadPStateRow<3>
+template <int Row> struct BadPStateRow {
+  static_assert(Row < 0, "invalid P-state row in a profile, see the Row template argument");
+  static constexpr bool ok = true;
+};
+
+template <const PStateInfo (&Table)[NUMPSTATES]> struct Profile {
+  static_assert(BadPStateRow<FirstBadPStateRow(Table)>::ok, "");
+
+  struct Words {
+    PStateWord w[NUMPSTATES];
+  };
+  static constexpr Words Encode() {
+    Words words = {};
+    for (int i = 0; i < NUMPSTATES; i++) {
+      words.w[i] = EncodePState(Table[i]);
+    }
+    return words;
+  }
+  static constexpr Words words = Encode();
+};
+
+//what the apply path writes: for P-state i, (msr & ~PSTATELOWMASK) | profile.w[i].lo
+constexpr const PStateWord* allpsiwords = Profile<allpsi>::words.w;
+
+//per-core profiles: allpsi has to be stable on the weakest core(cpu3 is the one failing first in unde.txt), a cpu listed here gets its own table instead, eg. lower voltages for a stronger core
+//fyi: the cores share one voltage plane, it gets the highest vid any core asks for, so a core's own lower vids only help while the weaker cores sit in slower P-states
+struct CoreProfile {
+  int cpu; //logical cpu number
+  const PStateInfo* table;
+  const PStateWord* words; //Profile<table>::words.w, ie. validated at compile time like allpsi
+};
+
+//eg. with a constexpr PStateInfo cpu0psi[NUMPSTATES] in mumu.h:  {0, cpu0psi, Profile<cpu0psi>::words.w},
+constexpr CoreProfile coreprofiles[]={
+  {-1, allpsi, allpsiwords} //end of list
+};
+
+//the profile of that cpu: its own from coreprofiles[] if it has one, else allpsi
+constexpr CoreProfile ProfileOfCpu(const int cpu) {
+  for (int i = 0; -1 != coreprofiles[i].cpu; i++) {
+    if (cpu == coreprofiles[i].cpu) {
+      return coreprofiles[i];
+    }
+  }
+  return { cpu, allpsi, allpsiwords };
+}
@@ -0,0 +1,221 @@
+#include "pstate.h"
+#include "msr.h"
+#include "cores.h"
+#include "timing.h"
+#include "telemetry.h"
+#include "codec.h"
+#include "boost.h"
+
+#include <cstdio> //for stdout; no iostream here, this file is part of the boot-time apply binary too
+#include <algorithm> //std::max
+#include <assert.h> //assert
+#include <atomic>
+
+static bool msrtrace=false;
+
+//reads regIndex on all online cores(in parallel) and returns core0's value; if percore is given it gets every core's value(indexed like Core(), see cores.h)
+uint64_t Rdmsr(const uint32_t regIndex, uint64_t* percore) {
+    uint64_t result[MAXCPUCORES]={0};
+    bool ok[MAXCPUCORES]={false};
+    const int numcores=NumCores();
+
+    RunOnEachCore([regIndex, &result, &ok](int i) {
+        ok[i]=MsrRead(Core(i).cpu, regIndex, result[i]);//read 8 bytes
+        });
+
+    for (int i = 0; i < numcores; i++) {
+      if (!ok[i]) {
+        fprintf(stderr, ERRORtext("!! Rdmsr: failed to read idx:%x from /dev/cpu/%d/msr") "\n", regIndex, Core(i).cpu);
+      }
+      if (msrtrace) {
+        fprintf(stdout, startYELLOWcolortext "  !! Rdmsr: /dev/cpu/%d/msr idx:%x ... %lu bytes ... ", Core(i).cpu, regIndex, sizeof(result[i]));
+        fprintf(stdout," done. (result==%" PRIu64 " hex:%08x%08x)" endcolor "\n", result[i], (unsigned int)(result[i] >> 32), (unsigned int)(result[i] & 0xFFFFFFFF));//just in case unsigned int gets more than 32 bits for wtw reason in the future! leave the & there.
+        if ((i>0) && (result[i-1] != result[i])) {
+          fprintf(stdout, startYELLOWcolortext "  !! Rdmsr: different results for cores(this is expected to be so depending on load) cpu[%d]==%" PRIu64 " != cpu[%d]==%" PRIu64 endcolor "\n", Core(i-1).cpu, result[i-1], Core(i).cpu, result[i]);
+        }
+      }
+      if (NULL != percore) {
+        percore[i]=result[i];
+      }
+    }
+
+    return result[0];//return only the core0 result
+}
+
+void Wrmsr(const uint32_t regIndex, const uint64_t& value) {
+    bool ok[MAXCPUCORES]={false};
+    const int numcores=NumCores();
+
+    RunOnEachCore([regIndex, &value, &ok](int i) {
+        ok[i]=MsrWrite(Core(i).cpu, regIndex, value);
+        });
+
+    for (int i = 0; i < numcores; i++) {
+        if (!ok[i]) {
+            fprintf(stderr, ERRORtext("!! Wrmsr: failed to write idx:%x to /dev/cpu/%d/msr") "\n", regIndex, Core(i).cpu);
+        }
+        if (msrtrace) {
+            //fprintf(stdout,"!! Wrmsr: %s idx:%"PRIu32" val:%"PRIu64"\n", path, index, value);
+            fprintf(stdout, startPURPLEcolortext "  !! Wrmsr: /dev/cpu/%d/msr idx:%x val:%" PRIu64 " valx:%08x%08x... done." endcolor "\n", Core(i).cpu, regIndex, value, (unsigned int)(value >> 32), (unsigned int)(value & 0xFFFFFFFF));
+        }
+    }
+}
+
+void SetMsrTrace(const bool on) {
+  msrtrace=on;
+}
+
+PStateInfo DecodePState(const uint32_t numpstate, const uint64_t msr) {
+  PStateInfo result;
+
+  //the family's own fid/did/vid layout, see codec.h
+  result.multi = Codec().multi(msr);
+  if ((result.multi < CPUMINMULTI) || (result.multi > CPUMAXMULTI)) {
+    fprintf(stderr, startREDcolortext "!! unexpected multiplier, you're probably running inside virtualbox bits:%04" PRIx64 " multi:%g" endcolor "\n", msr & Codec().mask, result.multi);
+  }
+  assert(result.multi>=CPUMINMULTI);
+  assert(result.multi<=CPUMAXMULTI);
+
+  result.VID = Codec().vid(msr);
+
+  fprintf(stdout,"!! ReadPState P%d bits:%04" PRIx64 " multi:%02.2f vid:%d\n", 
+      numpstate, msr & Codec().mask, result.multi, result.VID);
+  return result;
+}
+
+
+int GetCurrentPState() {
+  const uint64_t msr = Rdmsr(MSRCOFVIDSTATUS);
+  const int i = GetBits(msr, 16, 3);//0..7
+  return i;
+}
+
+int64_t SwitchCorePState(const int cpu, const int swpstate, const int64_t timeoutns) {
+  uint64_t msr;
+  if (!MsrRead(cpu, MSRPSTATECONTROL, msr)) {
+    return -1;
+  }
+  SetBits(msr, swpstate, 0, 3);
+  const int64_t start=NowNs();
+  if (!MsrWrite(cpu, MSRPSTATECONTROL, msr)) {
+    return -1;
+  }
+
+  //Next, wait for the new pstate to be set, code from: https://chromium.googlesource.com/chromiumos/third_party/coreboot/+/c02b4fc9db3c3c1e263027382697b566127f66bb/src/cpu/amd/model_10xxx/fidvid.c line 367
+  //but bounded, and with nothing else than the one status read in the loop
+  int64_t now=start;
+  do {
+    if (!MsrRead(cpu, MSRPSTATESTATUS, msr)) {
+      return -1;
+    }
+    now=NowNs();
+    if ((int)GetBits(msr, 0, 16) == swpstate) {
+      return now - start;
+    }
+  } while (now - start < timeoutns);
+  return -2;
+}
+
+static std::atomic<int> corecaps[MAXCPUCORES];//per cpu number, hardware numbering; 0 is no cap(zero-initialized, being static); set and read from any thread
+
+void SetCorePStateCap(const int cpu, const int fastest) {
+  assert((cpu >= 0) && (cpu < MAXCPUCORES));
+  corecaps[cpu].store(std::max(0, std::min(NUMPSTATES - 1, fastest)), std::memory_order_relaxed);
+}
+
+int CorePStateCap(const int cpu) {
+  return (((cpu >= 0) && (cpu < MAXCPUCORES)) ? corecaps[cpu].load(std::memory_order_relaxed) : 0);
+}
+
+int GetCorePState(const int cpu) {
+  uint64_t msr;
+  if (!MsrRead(cpu, MSRCOFVIDSTATUS, msr)) {
+    return -1;
+  }
+  return GetBits(msr, 16, 3);
+}
+
+bool GetCorePStateLimit(const int cpu, int& curlimit, int& maxval) {
+  uint64_t msr;
+  if (!MsrRead(cpu, MSRPSTATELIMIT, msr)) {
+    return false;
+  }
+  curlimit=SwToHw(GetBits(msr, 0, 3));
+  maxval=SwToHw(GetBits(msr, 4, 3));
+  return true;
+}
+
+int64_t SetCorePState(const int cpu, const int numpstate, const int64_t timeoutns) {
+  if (numpstate < 0 || numpstate >= NUMPSTATES)
+    throw ExceptionWithMessage("P-state index out of range");
+  int pstate=std::max(numpstate, CorePStateCap(cpu));
+  int curlimit, maxval;
+  if (GetCorePStateLimit(cpu, curlimit, maxval)) {
+    pstate=std::min(maxval, std::max(pstate, curlimit));//the hardware would clamp it too, but then the status never reports what we asked for
+  }
+  const int swpstate=HwToSw(pstate);//a boost state can only be asked for as software P0
+  const int64_t latency=SwitchCorePState(cpu, swpstate, timeoutns);
+  TelemetryRequest(cpu, SwToHw(swpstate), latency);
+  return latency;
+}
+
+bool SetCurrentPState(int numpstate, int64_t* maxlatencyns, const int64_t timeoutns) {
+  if (numpstate < 0 || numpstate >= NUMPSTATES)
+    throw ExceptionWithMessage("P-state index out of range");
+
+  //0xc0010062 counts from the first non-boost state: requesting a boost state means requesting software P0, the hardware boosts from there if CPB is on(see boost.h)
+  const int swpstate=HwToSw(numpstate);
+
+  int64_t latency[MAXCPUCORES];
+  RunOnEachCore([swpstate, timeoutns, &latency](int i) {
+      const int cpu=Core(i).cpu;
+      latency[i]=SwitchCorePState(cpu, std::max(swpstate, HwToSw(CorePStateCap(cpu))), timeoutns);//each core's own thread times its own write-to-acknowledge
+      });
+
+  bool ok=true;
+  int64_t maxlatency=0;
+  for (int i = 0; i < NumCores(); i++) {
+    TelemetryRequest(Core(i).cpu, SwToHw(std::max(swpstate, HwToSw(CorePStateCap(Core(i).cpu)))), latency[i]);
+    if (latency[i] < 0) {
+      ok=false;
+      fprintf(stderr, ERRORtext("!! SetCurrentPState: cpu%d %s switching to software P%d") "\n",
+          Core(i).cpu, (-2 == latency[i] ? "timed out" : "failed msr access"), swpstate);
+    } else {
+      maxlatency=std::max(maxlatency, latency[i]);
+    }
+  }
+  if (msrtrace) {
+    fprintf(stdout, "!! SetCurrentPState: software P%d on %d cores, slowest acknowledged after %.1fus\n", swpstate, NumCores(), maxlatency / 1000.0);
+  }
+  if (NULL != maxlatencyns) {
+    *maxlatencyns=maxlatency;
+  }
+  return ok;
+}
+
+double vid2voltage(const int vid) {
+  return Codec().voltage(vid);//1.55 - vid*0.0125 on all but the SVI2 ones
+}
+
+int voltage2vid(double voltage) {
+  assert(CPUVIDSTEP > 0);
+  assert(voltage > 0.0);
+  assert(voltage < V155);//XXX: actual max for my CPU is probably 1.40V though!(need to verify this).
+  //^ wanna catch the mistake rather than just round to the limits
+
+  //XXX: here, just making sure input voltage doesn't exceed 1.325V ! (my CPU)
+  voltage = std::max(0.0, std::min(V1325, voltage));//done: use a less than 1.55 max voltage there, depending on reported one which is 1.325V for my cpu eg. 1.45 shouldn't be allowed!; OK, maybe that 1.55 is something else... in which case ignore all this.
+
+  assert(voltage<=V1325);
+  assert(voltage >= CPUMINVOLTAGEunderclocked); //that's the lowest (pstate7) stable voltage for my CPU, multi:8x
+  //    assert(vid<=1.0875); //that's highest (pstate0) stable voltage for my CPU, multi:22x; but initially it's 1.325V at 22x pstate0, before the downclocking!
+  assert(voltage <= CPUMAXVOLTAGE);//when not underclocked, this is tops
+  // round to nearest step
+  int r = (int)(voltage / CPUVIDSTEP + 0.5);
+
+  //1.55 / VIDStep = highest VID (124)
+  int vid= (int)(V155 / CPUVIDSTEP) - r;//VIDStep is 0.0125; so, 124 - 87(for 1.0875 aka 22x multi) = 37
+  assert(vid >= CPUMAXVID);//multi 23x, fid 30, did 2, vid 18, pstate0 (highest) normal clocked
+  assert(vid <= CPUMINVIDunderclocked);//multi 8x, fid 0, did 2 vid 67, pstate7(lowest) underclocked
+  return vid;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "mumu.h"
+#include "profile.h"
+#include "snapshot.h" //for the MSR* register indexes
+
+//all-core register access: the same register of every online core, in parallel
+//no output except for failures, unless the trace is on(--verbose): then every core's value is printed, like it used to always be
+//reads regIndex on all online cores and returns core0's value; if percore is given it gets every core's value(indexed like Core(), see cores.h)
+uint64_t Rdmsr(const uint32_t regIndex, uint64_t* percore=NULL);
+void Wrmsr(const uint32_t regIndex, const uint64_t& value);
+void SetMsrTrace(const bool on);
+
+//VID <-> voltage, at runtime(the profiles are encoded at compile time, see profile.h); decoding a register goes through Codec() instead(see codec.h), which knows the other families too
+double vid2voltage(const int vid);
+int voltage2vid(double voltage);
+
+PStateInfo DecodePState(const uint32_t numpstate, const uint64_t msr);
+
+#define PSTATETRANSITIONTIMEOUTNS 20000000 //20ms, a transition including the voltage ramp takes well under 1ms
+
+int GetCurrentPState();
+//requests that P-state on all cores(in parallel) and waits, bounded by timeoutns, until each core reports it reached it
+//a core with a cap(see SetCorePStateCap()) gets its cap instead, if that's slower; a boost state is requested as software P0(see boost.h)
+//returns false if any core failed or timed out; maxlatencyns gets the slowest core's write-to-acknowledge time
+bool SetCurrentPState(int numpstate, int64_t* maxlatencyns=NULL, const int64_t timeoutns=PSTATETRANSITIONTIMEOUTNS);
+
+//per-core control, hardware numbering like GetCurrentPState(); no printing
+int GetCorePState(const int cpu);//the P-state that cpu is running in, -1 on msr access failure
+//0xc0010061 is read-only on family 12h: the limit the hardware imposes(eg. when hot) and the slowest P-state there is
+bool GetCorePStateLimit(const int cpu, int& curlimit, int& maxval);
+//the limit we impose instead, in software: from now on requests for that cpu faster than fastest get clamped to it, 0 removes the cap
+//only for requests made through this process(the governor's --cap, run's policies, amdmsrt_set_limit()): nothing is written, it's gone when the process exits and another process or cpufreq can still request faster P-states
+void SetCorePStateCap(const int cpu, const int fastest);
+int CorePStateCap(const int cpu);
+//requests that P-state on that cpu only(clamped to its cap and to the hardware limit) and waits for it, see SwitchCorePState() for the return value
+int64_t SetCorePState(const int cpu, const int numpstate, const int64_t timeoutns=PSTATETRANSITIONTIMEOUTNS);
+//the same for one cpu, with a software P-state number(what 0xc0010062/0xc0010063 use): no printing, returns the write-to-acknowledge latency in ns, -1 on msr access failure, -2 on timeout
+int64_t SwitchCorePState(const int cpu, const int swpstate, const int64_t timeoutns);
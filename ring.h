@@ -0,0 +1,41 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+
+//lock-free single-producer single-consumer ring buffer: one thread Push()es, one other thread Pop()s, neither ever blocks
+//Size must be a power of 2; one slot stays unused to tell full from empty
+template <typename T, size_t Size> class SpscRing {
+  static_assert((Size >= 2) && (0 == (Size & (Size - 1))), "SpscRing size must be a power of 2");
+
+  alignas(64) std::atomic<size_t> head; //next slot to write, only the producer stores it
+  alignas(64) std::atomic<size_t> tail; //next slot to read, only the consumer stores it
+  alignas(64) T buf[Size];
+
+public:
+
+  SpscRing() : head(0), tail(0) {}
+
+  //producer side; returns false(and drops item) if the consumer fell behind and the ring is full
+  bool Push(const T& item) {
+    const size_t h=head.load(std::memory_order_relaxed);
+    const size_t next=(h + 1) & (Size - 1);
+    if (next == tail.load(std::memory_order_acquire)) {
+      return false;
+    }
+    buf[h]=item;
+    head.store(next, std::memory_order_release);
+    return true;
+  }
+
+  //consumer side; returns false if there's nothing to read
+  bool Pop(T& item) {
+    const size_t t=tail.load(std::memory_order_relaxed);
+    if (t == head.load(std::memory_order_acquire)) {
+      return false;
+    }
+    item=buf[t];
+    tail.store((t + 1) & (Size - 1), std::memory_order_release);
+    return true;
+  }
+};
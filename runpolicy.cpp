@@ -0,0 +1,287 @@
+#include "runpolicy.h"
+#include "mumu.h"
+#include "msr.h"
+#include "cores.h"
+#include "pstate.h"
+#include "boost.h"
+#include "options.h"
+#include "simcpu.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sched.h>
+#include <poll.h>
+#include <sys/prctl.h>
+#include <sys/signalfd.h>
+#include <sys/wait.h>
+
+struct PStatePolicy {
+  const char* name;
+  int command; //P-state(hardware numbering) for the command's cores, 0 is software P0 which boosts if CPB is on(see boost.h)
+  int others; //P-state for the remaining cores, -1 leaves them alone
+  const char* what;
+};
+
+static const PStatePolicy policies[]={
+  {"full", 0, -1, "fastest P-state on the command's cores, boosting when there's headroom if CPB is on"},
+  {"foreground", 0, NUMPSTATES - 1, "fastest on the command's cores, slowest on all the others"},
+  {"efficient", NUMPSTATES - 1, -1, "slowest P-state on the command's cores, for long background jobs"},
+  {NULL, 0, 0, NULL}
+};
+
+static const PStatePolicy* FindPolicy(const char* name) {
+  for (int i = 0; NULL != policies[i].name; i++) {
+    if ((NULL != name) && (0 == strcmp(name, policies[i].name))) {
+      return &policies[i];
+    }
+  }
+  return NULL;
+}
+
+//every core's 0xc0010062, in software numbering, read in one parallel pass
+static bool SaveRequests(int* swpstate) {
+  bool ok[MAXCPUCORES]={false};
+  RunOnEachCore([swpstate, &ok](int i) {
+      uint64_t msr=0;
+      ok[i]=MsrRead(Core(i).cpu, MSRPSTATECONTROL, msr);
+      swpstate[i]=GetBits(msr, 0, 3);
+      });
+  for (int i = 0; i < NumCores(); i++) {
+    if (!ok[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static int RestoreRequests(const int* swpstate) {
+  int failed[MAXCPUCORES]={0};
+  RunOnEachCore([swpstate, &failed](int i) {
+      failed[i]=(SwitchCorePState(Core(i).cpu, swpstate[i], PSTATETRANSITIONTIMEOUTNS) < 0 ? 1 : 0);
+      });
+  int errors=0;
+  for (int i = 0; i < NumCores(); i++) {
+    errors += failed[i];
+  }
+  return errors;
+}
+
+//cpufreq's governors write 0xc0010062 too(acpi-cpufreq), anything but userspace overrides the policy's requests sooner or later; returns how many of the policy's cores have one
+static int WarnAboutCpufreq(const int* pstates) {
+  int overriding=0;
+  char governor[64]="\0";
+  for (int i = 0; i < NumCores(); i++) {
+    if (-1 == pstates[i]) {
+      continue;
+    }
+    char path[128];
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cpufreq/scaling_governor", Core(i).cpu);
+    FILE* f=fopen(path, "r");
+    if (NULL == f) {
+      continue;//no cpufreq driver on it, nothing to fight with
+    }
+    char name[64]="\0";
+    const bool ok=(NULL != fgets(name, sizeof(name), f));
+    fclose(f);
+    name[strcspn(name, "\n")]='\0';
+    if (ok && (0 != strcmp("userspace", name))) {
+      overriding++;
+      snprintf(governor, sizeof(governor), "%s", name);
+    }
+  }
+  if (overriding > 0) {
+    fprintf(stderr, ERRORtext("!! run: the cpufreq governor of %d of the policy's cores is %s, not userspace: it will override the requests(put back every --recheck-ms), use 'cpupower frequency-set -g userspace' as 'go' does") "\n", overriding, governor);
+  }
+  return overriding;
+}
+
+//puts back the policy's request on those of its cores where something else(cpufreq) changed 0xc0010062, returns on how many
+static int Reassert(const int* enforced) {
+  int changed[MAXCPUCORES]={0};
+  RunOnEachCore([enforced, &changed](int i) {
+      uint64_t msr=0;
+      if ((-1 == enforced[i]) || !MsrRead(Core(i).cpu, MSRPSTATECONTROL, msr) || ((int)GetBits(msr, 0, 3) == enforced[i])) {
+        return;
+      }
+      SwitchCorePState(Core(i).cpu, enforced[i], PSTATETRANSITIONTIMEOUTNS);
+      changed[i]=1;
+      });
+  int count=0;
+  for (int i = 0; i < NumCores(); i++) {
+    count += changed[i];
+  }
+  return count;
+}
+
+int RunWithPolicy(const int argc, const char* argv[]) {
+  //options are only looked for before "--", everything after it is the command's
+  int sep=1;
+  while ((sep < argc) && (0 != strcmp("--", argv[sep]))) {
+    sep++;
+  }
+  const PStatePolicy* policy=FindPolicy(OptValue(sep, argv, "--policy"));
+  if ((NULL == policy) || (sep + 1 >= argc)) {
+    fprintf(stderr, ERRORtext("!! run: usage: run --policy=<name> [--cpus=2,3] [--pin] [--boost=on|off] [--recheck-ms=100] -- <command> [args...]") "\n");
+    for (int i = 0; NULL != policies[i].name; i++) {
+      fprintf(stderr, "  %-10s %s\n", policies[i].name, policies[i].what);
+    }
+    return 2;
+  }
+  bool selected[MAXCPUCORES]={false};//by core index
+  int cpus[MAXCPUCORES];
+  const int numcpus=OptIntList(sep, argv, "--cpus", cpus, MAXCPUCORES);
+  if ((-1 == numcpus) && (NULL != OptValue(sep, argv, "--cpus"))) {
+    fprintf(stderr, ERRORtext("!! run: --cpus wants a list eg. --cpus=2,3") "\n");
+    return 2;
+  }
+  for (int i = 0; i < numcpus; i++) {
+    const int idx=CoreIndexOfCpu(cpus[i]);
+    if (-1 == idx) {
+      fprintf(stderr, ERRORtext("!! run: cpu%d is not online") "\n", cpus[i]);
+      return 2;
+    }
+    selected[idx]=true;
+  }
+  for (int i = 0; (-1 == numcpus) && (i < NumCores()); i++) {
+    selected[i]=true;
+  }
+  const bool pin=HasArg(sep, argv, "--pin") && (numcpus > 0);
+  const char* boostopt=OptValue(sep, argv, "--boost");
+  if ((NULL != boostopt) && (0 != strcmp("on", boostopt)) && (0 != strcmp("off", boostopt))) {
+    fprintf(stderr, ERRORtext("!! run: --boost wants on or off") "\n");
+    return 2;
+  }
+  const int recheckms=OptInt(sep, argv, "--recheck-ms", 100);
+  if (recheckms < 0) {
+    fprintf(stderr, ERRORtext("!! run: --recheck-ms wants 0(off) or more") "\n");
+    return 2;
+  }
+  bool cpbwas=false;
+  if ((NULL != boostopt) && !GetCpb(Core(0).cpu, cpbwas)) {
+    pERR("run: failed to read whether boost is enabled, not starting");
+    return 3;
+  }
+
+  int saved[MAXCPUCORES];
+  if (!SaveRequests(saved)) {
+    pERR("run: failed to read the current P-state requests, not starting");
+    return 3;
+  }
+
+  //blocked before fork, so none of them can kill us between applying and restoring; the child unblocks them again
+  sigset_t sigs;
+  sigemptyset(&sigs);
+  sigaddset(&sigs, SIGINT);
+  sigaddset(&sigs, SIGTERM);
+  sigaddset(&sigs, SIGHUP);
+  sigaddset(&sigs, SIGQUIT);
+  sigaddset(&sigs, SIGCHLD);
+  sigset_t oldsigs;
+  sigprocmask(SIG_BLOCK, &sigs, &oldsigs);
+  const int sigfd=signalfd(-1, &sigs, SFD_CLOEXEC);
+  if (-1 == sigfd) {
+    pERR("run: signalfd failed");
+    return 3;
+  }
+
+  //the cores the policy slows down also get it as their cap(see SetCorePStateCap()), so nothing in this process requests them faster meanwhile; the caps they had are put back afterwards
+  int pstates[MAXCPUCORES];
+  int savedcaps[MAXCPUCORES];
+  int enforced[MAXCPUCORES];//what the policy wrote to 0xc0010062, software numbering, -1 where it left the core alone
+  int errors=0;
+  for (int i = 0; i < NumCores(); i++) {
+    pstates[i]=(selected[i] ? policy->command : policy->others);
+    savedcaps[i]=CorePStateCap(Core(i).cpu);
+    enforced[i]=-1;
+    if (-1 == pstates[i]) {
+      continue;
+    }
+    if (pstates[i] > 0) {
+      SetCorePStateCap(Core(i).cpu, pstates[i]);
+    }
+    uint64_t msr=0;
+    if ((SetCorePState(Core(i).cpu, pstates[i]) < 0) || !MsrRead(Core(i).cpu, MSRPSTATECONTROL, msr)) {
+      errors++;
+      continue;
+    }
+    enforced[i]=GetBits(msr, 0, 3);
+  }
+  if (!SimRequested(sep, argv)) {
+    WarnAboutCpufreq(pstates);
+  }
+  if (NULL != boostopt) {
+    errors += SetCpb(0 == strcmp("on", boostopt));
+  }
+  fprintf(stdout, "run: policy %s%s%s: %s\n", policy->name, (NULL == boostopt ? "" : (0 == strcmp("on", boostopt) ? ", boost on" : ", boost off")),
+      (0 == errors ? "" : " (some cores failed)"), policy->what);
+  fflush(stdout);
+
+  const pid_t parent=getpid();
+  const pid_t child=fork();
+  if (0 == child) {
+    prctl(PR_SET_PDEATHSIG, SIGTERM);//if we get SIGKILLed the command doesn't run on with nobody to restore afterwards
+    if (getppid() != parent) {
+      _exit(127);//died before the prctl
+    }
+    if (pin) {
+      cpu_set_t set;
+      CPU_ZERO(&set);
+      for (int i = 0; i < numcpus; i++) {
+        CPU_SET(cpus[i], &set);
+      }
+      sched_setaffinity(0, sizeof(set), &set);
+    }
+    sigprocmask(SIG_SETMASK, &oldsigs, NULL);
+    execvp(argv[sep + 1], (char* const*)(argv + sep + 1));
+    fprintf(stderr, ERRORtext("!! run: failed to execute %s") ": %s\n", argv[sep + 1], strerror(errno));
+    _exit(127);
+  }
+
+  int status=0;
+  if (-1 == child) {
+    pERR("run: fork failed");
+    status=-1;
+  } else {
+    //forward what was sent to us; what the terminal sent(^C, ^\) went to the command already, it's in the same process group
+    //and every recheckms put back the policy's requests if cpufreq changed them
+    int reasserted=0;
+    bool done=false;
+    while (!done) {
+      struct pollfd pfd = { sigfd, POLLIN, 0 };
+      if (0 == poll(&pfd, 1, (recheckms > 0 ? recheckms : -1))) {
+        reasserted += Reassert(enforced);
+        continue;
+      }
+      struct signalfd_siginfo si;
+      if (sizeof(si) != read(sigfd, &si, sizeof(si))) {
+        continue;
+      }
+      if (SIGCHLD == si.ssi_signo) {
+        done=(child == waitpid(child, &status, WNOHANG));
+      } else if (SI_KERNEL != si.ssi_code) {
+        kill(child, si.ssi_signo);
+      }
+    }
+    if (reasserted > 0) {
+      fprintf(stdout, "run: put the policy's request back %d times after something else(cpufreq) changed it\n", reasserted);
+    }
+  }
+  close(sigfd);
+
+  for (int i = 0; i < NumCores(); i++) {
+    SetCorePStateCap(Core(i).cpu, savedcaps[i]);
+  }
+  int restorefailed=RestoreRequests(saved);
+  if (NULL != boostopt) {
+    restorefailed += SetCpb(cpbwas);
+  }
+  fprintf(stdout, "run: restored the previous P-state requests%s%s\n", (NULL == boostopt ? "" : " and boost"), (0 == restorefailed ? "" : " (some cores failed)"));
+  sigprocmask(SIG_SETMASK, &oldsigs, NULL);
+  if (-1 == status) {
+    return 3;
+  }
+  return (WIFSIGNALED(status) ? 128 + WTERMSIG(status) : WEXITSTATUS(status));
+}
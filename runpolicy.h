@@ -0,0 +1,12 @@
+#pragma once
+
+//runs a command under a temporary P-state policy and puts every core's P-state request back when it exits(normally, crashed, or killed by a signal sent to either process)
+//usage: run --policy=<name> [--cpus=2,3] [--pin] [--boost=on|off] [--recheck-ms=100] -- <command> [args...]
+//  --cpus  the cores the policy's command P-state goes to(default all), the other cores get the policy's P-state for the rest, if it has one
+//  --pin   also restricts the command to those cores
+//  --boost enables/disables CPB on all cores while the command runs(see boost.h), eg. off for a long all-core build, on for a single-threaded job; put back afterwards
+//  --recheck-ms  how often the policy's cores' requests are checked and put back if something else changed them, 0 never
+//only 0xc0010062(the request) and with --boost HWCR change, the P-state definitions stay as they are; any cpufreq governor but userspace(as 'go' sets it) writes 0xc0010062 too:
+//that's warned about and undone every --recheck-ms, but it can still win in between, so use cpupower's userspace governor
+//returns the command's exit status(128+signal if it was killed), 2 on bad options, 3 if it couldn't be started
+int RunWithPolicy(const int argc, const char* argv[]);
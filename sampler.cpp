@@ -0,0 +1,211 @@
+#include "sampler.h"
+#include "mumu.h"
+#include "msr.h"
+#include "cores.h"
+#include "pstate.h"
+#include "codec.h"
+#include "options.h"
+#include "timing.h"
+#include "ring.h"
+#include "telemetry.h"
+#include "boost.h"
+
+#include <stdio.h>
+#include <string.h> //memset
+#include <time.h>
+#include <signal.h>
+#include <unistd.h> //getpid
+#include <atomic>
+#include <memory>
+#include <thread>
+
+#define SAMPLERRINGSIZE 4096 //per core; drained every SAMPLERDRAINNS, so that's ~400ms of samples at the default 200us before anything gets dropped
+#define SAMPLERDRAINNS 10000000
+
+struct PStateSample {
+  int64_t ns;
+  int running; //from COFVID, hardware numbering
+  int acknowledged; //from 0xc0010063, hardware numbering
+  bool ok;
+};
+
+typedef SpscRing<PStateSample, SAMPLERRINGSIZE> SampleRing;
+
+//what the draining thread builds, one per core
+struct Residency {
+  int64_t ns[NUMPSTATES]; //time spent in each P-state, between consecutive samples
+  uint64_t transitions[NUMPSTATES][NUMPSTATES]; //[from][to]
+  uint64_t samples;
+  uint64_t failed; //samples with a failed msr read
+  uint64_t pending; //samples where the running P-state wasn't the acknowledged one(transition in flight, or a hardware limit); boosting from software P0 doesn't count
+  int last; //-1 before the first sample
+  int64_t lastns;
+};
+
+static void Account(const int cpu, Residency& r, const PStateSample& s) {
+  r.samples++;
+  if (!s.ok) {
+    r.failed++;
+    return;
+  }
+  if ((s.running != s.acknowledged) && !(IsBoostPState(s.running) && (SwToHw(0) == s.acknowledged))) {
+    r.pending++;
+  }
+  if (-1 != r.last) {
+    r.ns[r.last] += s.ns - r.lastns;
+    if (s.running != r.last) {
+      r.transitions[r.last][s.running]++;
+      TelemetryTransition(cpu, r.last, s.running, s.ns);
+    }
+  }
+  r.last=s.running;
+  r.lastns=s.ns;
+}
+
+//multis[i][p] is core i's P-state p as defined when the sampler started, so the labels match what's actually running(eg. after apply or search)
+static void Dump(const Residency* res, const std::atomic<uint64_t>* dropped, const double (*multis)[NUMPSTATES], const int64_t start) {
+  fprintf(stdout, "sampler: after %.3fs; residency per P-state(hardware numbering, B for a boost state), transitions as from->to:count\n", (NowNs() - start) / 1e9);
+  int64_t alltotal=0, allboosted=0;
+  for (int i = 0; i < NumCores(); i++) {
+    const Residency& r=res[i];
+    int64_t total=0, boosted=0;
+    uint64_t transitions=0;
+    for (int p = 0; p < NUMPSTATES; p++) {
+      total += r.ns[p];
+      boosted += (IsBoostPState(p) ? r.ns[p] : 0);
+      for (int q = 0; q < NUMPSTATES; q++) {
+        transitions += r.transitions[p][q];
+      }
+    }
+    alltotal += total;
+    allboosted += boosted;
+    fprintf(stdout, "  cpu%d: %" PRIu64 " samples, %" PRIu64 " dropped, %" PRIu64 " failed, %.1f%% pending, %" PRIu64 " transitions, %.1f%% boosted\n   ",
+        Core(i).cpu, r.samples, dropped[i].load(), r.failed, (r.samples > 0 ? 100.0 * r.pending / r.samples : 0.0), transitions,
+        (total > 0 ? 100.0 * boosted / total : 0.0));
+    for (int p = 0; p < NUMPSTATES; p++) {
+      fprintf(stdout, " %s%d(%gx):%5.1f%%", (IsBoostPState(p) ? "B" : "P"), p, multis[i][p], (total > 0 ? 100.0 * r.ns[p] / total : 0.0));
+    }
+    fprintf(stdout, "\n");
+    if (transitions > 0) {
+      fprintf(stdout, "   ");
+      for (int p = 0; p < NUMPSTATES; p++) {
+        for (int q = 0; q < NUMPSTATES; q++) {
+          if (r.transitions[p][q] > 0) {
+            fprintf(stdout, " %s%d->%s%d:%" PRIu64, (IsBoostPState(p) ? "B" : "P"), p, (IsBoostPState(q) ? "B" : "P"), q, r.transitions[p][q]);
+          }
+        }
+      }
+      fprintf(stdout, "\n");
+    }
+  }
+  fprintf(stdout, "  all cores: %.1f%% of the time in boost states\n", (alltotal > 0 ? 100.0 * allboosted / alltotal : 0.0));
+  fflush(stdout);
+}
+
+int RunSampler(const int argc, const char* argv[]) {
+  const int64_t intervalns=(int64_t)OptInt(argc, argv, "--interval-us", 200) * 1000;
+  const int64_t durationns=(int64_t)OptInt(argc, argv, "--seconds", 0) * 1000000000;
+  const int64_t dumpns=(int64_t)OptInt(argc, argv, "--dump-s", 0) * 1000000000;
+  if ((intervalns <= 0) || (durationns < 0) || (dumpns < 0)) {
+    fprintf(stderr, ERRORtext("!! sampler: invalid options") "\n");
+    return 2;
+  }
+
+  //blocked before any thread exists, so only sigtimedwait() below ever sees them
+  sigset_t sigs;
+  sigemptyset(&sigs);
+  sigaddset(&sigs, SIGINT);
+  sigaddset(&sigs, SIGTERM);
+  sigaddset(&sigs, SIGHUP);
+  sigaddset(&sigs, SIGUSR1);
+  sigprocmask(SIG_BLOCK, &sigs, NULL);
+
+  const int numcores=NumCores();
+  std::unique_ptr<SampleRing[]> rings(new SampleRing[numcores]);
+  std::unique_ptr<Residency[]> res(new Residency[numcores]);
+  memset(res.get(), 0, numcores * sizeof(Residency));
+  std::atomic<uint64_t> dropped[MAXCPUCORES];
+  for (int i = 0; i < numcores; i++) {
+    res[i].last=-1;
+    dropped[i]=0;
+  }
+  double multis[MAXCPUCORES][NUMPSTATES];
+  for (int p = 0; p < NUMPSTATES; p++) {
+    uint64_t defs[MAXCPUCORES];
+    Rdmsr(MSRPSTATEDEF0 + p, defs);
+    for (int i = 0; i < numcores; i++) {
+      multis[i][p]=Codec().multi(defs[i]);
+    }
+  }
+  std::atomic<bool> stop(false);
+  const int64_t start=NowNs();
+
+  fprintf(stdout, "sampler: %d cores every %.0fus, kill -USR1 %d to dump\n", numcores, intervalns / 1000.0, (int)getpid());
+  fflush(stdout);
+
+  auto drain=[&]() {
+    PStateSample s;
+    for (int i = 0; i < numcores; i++) {
+      while (rings[i].Pop(s)) {
+        Account(Core(i).cpu, res[i], s);
+      }
+    }
+  };
+
+  //the consumer: drains all rings, handles the signals, the deadline and the periodic dumps
+  std::thread consumer([&]() {
+      const struct timespec timeout = { 0, SAMPLERDRAINNS };
+      int64_t lastdump=start;
+      while (!stop) {
+        const int sig=sigtimedwait(&sigs, NULL, &timeout);
+        drain();
+        const int64_t now=NowNs();
+        if (SIGUSR1 == sig) {
+          Dump(res.get(), dropped, multis, start);
+        } else if ((SIGINT == sig) || (SIGTERM == sig) || (SIGHUP == sig)) {
+          fprintf(stdout, "sampler: got signal %d, exiting\n", sig);
+          stop=true;
+        }
+        if ((durationns > 0) && (now - start >= durationns)) {
+          stop=true;
+        }
+        if ((dumpns > 0) && (now - lastdump >= dumpns)) {
+          Dump(res.get(), dropped, multis, start);
+          lastdump=now;
+        }
+      }
+      });
+
+  //the producers: one per core, reading its own msrs(no IPIs) on an absolute schedule
+  RunOnEachCore([&](int i) {
+      const int cpu=Core(i).cpu;
+      struct timespec next;
+      clock_gettime(CLOCK_MONOTONIC, &next);
+      while (!stop) {
+        PStateSample s;
+        uint64_t cofvid=0, status=0;
+        s.ok = MsrRead(cpu, MSRCOFVIDSTATUS, cofvid);
+        s.ok = MsrRead(cpu, MSRPSTATESTATUS, status) && s.ok;
+        s.ns = NowNs();
+        s.running = GetBits(cofvid, 16, 3);
+        s.acknowledged = SwToHw(GetBits(status, 0, 3));
+        if (!rings[i].Push(s)) {
+          dropped[i]++;
+        }
+        next.tv_nsec += intervalns;
+        while (next.tv_nsec >= 1000000000) {
+          next.tv_nsec -= 1000000000;
+          next.tv_sec++;
+        }
+        if ((int64_t)next.tv_sec * 1000000000 + next.tv_nsec < s.ns) {
+          clock_gettime(CLOCK_MONOTONIC, &next);//fell behind(eg. preempted), skip the missed slots instead of catching up in a burst
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+      }
+      });
+
+  consumer.join();
+  drain();//whatever the producers pushed after the consumer's last pass
+  Dump(res.get(), dropped, multis, start);
+  return 0;
+}
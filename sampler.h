@@ -0,0 +1,7 @@
+#pragma once
+
+//P-state residency sampler: a thread pinned to each core polls its COFVID status(0xc0010071) and P-state status(0xc0010063) every --interval-us into a lock-free ring(see ring.h), another thread drains the rings into per-core residency histograms and transition counts
+//the tables are printed on SIGUSR1, every --dump-s seconds if given, and at exit(--seconds, or SIGINT/SIGTERM)
+//options: --interval-us=200 --seconds=0(0 is until killed) --dump-s=0
+//returns the process exit code
+int RunSampler(const int argc, const char* argv[]);
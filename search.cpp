@@ -0,0 +1,252 @@
+#include "search.h"
+#include "mumu.h"
+#include "codec.h"
+#include "pstate.h"
+#include "stress.h"
+#include "msr.h"
+#include "cores.h"
+#include "options.h"
+
+#include <stdio.h>
+#include <algorithm> //std::max
+#include <stdlib.h> //strtod
+#include <unistd.h> //sleep fsync
+
+//one per P-state slot, in slot order: the table has to have all NUMPSTATES rows to be pasteable as allpsi
+struct SearchEntry {
+  double multi;
+  int stablevid; //highest(ie. lowest voltage) VID that passed, -1 if even CPUMAXVIDunderclocked failed
+  int vid; //stablevid minus the margin, what goes into the table
+};
+
+//writes that multi/VID into P-state slot on all cores, keeping every other bit of each core's definition
+static bool WriteCandidate(const int slot, const uint64_t* original, const double multi, const int vid) {
+  uint64_t bits=0;
+  if (!Codec().encode(multi, vid, bits)) {
+    return false;
+  }
+  bool ok=true;
+  for (int i = 0; i < NumCores(); i++) {
+    const uint64_t msr=(original[i] & ~Codec().mask) | bits;
+    ok = MsrWrite(Core(i).cpu, MSRPSTATEDEF0 + slot, msr) && ok;
+  }
+  return ok;
+}
+
+static void RestoreSlot(const int slot, const uint64_t* original) {
+  SetCurrentPState(NUMPSTATES - 1);
+  for (int i = 0; i < NumCores(); i++) {
+    MsrWrite(Core(i).cpu, MSRPSTATEDEF0 + slot, original[i]);
+  }
+}
+
+//0 stable, 1 unstable, 2 too hot/couldn't run(search must stop)
+static int TryCandidate(const int slot, const uint64_t* original, const double multi, const int vid,
+    const double seconds, const double maxtemp, const int cooldown) {
+  //leave the slot first, so the new definition is what gets latched when switching back to it
+  SetCurrentPState(NUMPSTATES - 1);
+  sleep(cooldown);
+  if (!WriteCandidate(slot, original, multi, vid)) {
+    pERR("search: failed to write the candidate P-state");
+    return 2;
+  }
+  fprintf(stdout, "search: %.2fx at %.4fV(vid:%d) ...\n", multi, vid2voltage(vid), vid);
+  fflush(stdout);//the next thing might be a hang, at least the log should say what it was trying
+  StressResult result;
+  if (!StressCores(slot, seconds, maxtemp, true, result)) {
+    return 2;
+  }
+  if (result.overheated) {
+    fprintf(stdout, "search: %.1fC reached, stopping the search\n", result.peaktemp);
+    return 2;
+  }
+  for (int i = 0; i < result.numcores; i++) {
+    if (result.errors[i] > 0) {
+      fprintf(stdout, "search:   unstable(cpu%d failed)\n", result.cpu[i]);
+      return 1;
+    }
+  }
+  fprintf(stdout, "search:   stable(peak %.1fC)\n", result.peaktemp);
+  return 0;
+}
+
+//the results so far, as comments only(not a table): a later candidate may well freeze the machine, this survives that
+static void WriteProgress(const char* path, const SearchEntry* entries, const int count, const int margin) {
+  FILE* f=fopen(path, "w");
+  if (NULL == f) {
+    pERR("search: failed to write the progress file");
+    return;
+  }
+  fprintf(f, "//amdmsrt4myZ575 search in progress, +%d VID steps(%.4fV) margin; the allpsi table is only written once every slot is stable\n", margin, margin * CPUVIDSTEP);
+  for (int i = 0; i < count; i++) {
+    if (entries[i].stablevid < 0) {
+      fprintf(f, "//P%d %.2fx: unstable even at %.4fV\n", i, entries[i].multi, vid2voltage(CPUMAXVIDunderclocked));
+    } else {
+      fprintf(f, "//P%d %.2fx: stable down to %.4fV(vid:%d), using %.4fV(vid:%d)\n", i, entries[i].multi,
+          vid2voltage(entries[i].stablevid), entries[i].stablevid, vid2voltage(entries[i].vid), entries[i].vid);
+    }
+  }
+  fflush(f);
+  fsync(fileno(f));
+  fclose(f);
+}
+
+//all NUMPSTATES rows in slot order, in the form mumu.h's allpsi has, so it passes profile.h's checks when pasted there
+static bool WriteTable(const char* path, const SearchEntry* entries, const int margin) {
+  FILE* f=fopen(path, "w");
+  if (NULL == f) {
+    pERR("search: failed to write the table");
+    return false;
+  }
+  fprintf(f, "constexpr struct PStateInfo allpsi[NUMPSTATES]={//found by: amdmsrt4myZ575 search, +%d VID steps(%.4fV) margin\n", margin, margin * CPUVIDSTEP);
+  for (int i = 0; i < NUMPSTATES; i++) {
+    fprintf(f, "  {%.2f, %.4f, %d}%s //P%d, stable down to %.4fV(vid:%d)\n", entries[i].multi, vid2voltage(entries[i].vid), entries[i].vid,
+        (NUMPSTATES - 1 == i ? "" : ","), i, vid2voltage(entries[i].stablevid), entries[i].stablevid);
+  }
+  fprintf(f, "};\n");
+  fflush(f);
+  fsync(fileno(f));
+  fclose(f);
+  return true;
+}
+
+int RunSearch(const int argc, const char* argv[]) {
+  //the VID and multiplier bounds(CPUMAXVIDunderclocked etc.) are family 12h ones: the same VID is a higher voltage on another family's codec, eg. about 1.44V on 15h SVI2
+  if (CPUFAMILY != Codec().family) {
+    fprintf(stderr, ERRORtext("!! search: the voltage bounds are for family 12h, not searching on family %s") "\n", Codec().name);
+    return 2;
+  }
+  const int slot=OptInt(argc, argv, "--slot", 1);
+  const double seconds=OptDouble(argc, argv, "--seconds", 60.0);
+  const double maxtemp=OptDouble(argc, argv, "--max-temp", 90.0);
+  const int margin=OptInt(argc, argv, "--margin", 2);
+  const int cooldown=OptInt(argc, argv, "--cooldown", 5);
+  const char* out=OptValue(argc, argv, "--out");
+  if (NULL == out) {
+    out="searched_allpsi.txt";
+  }
+  //the slowest P-state is where we wait between candidates and P0 can't be requested directly
+  if ((slot < 1) || (slot >= NUMPSTATES - 1) || (seconds <= 0) || (margin < 0) || (cooldown < 0)) {
+    fprintf(stderr, ERRORtext("!! search: invalid options") "\n");
+    return 2;
+  }
+
+  SearchEntry entries[NUMPSTATES];
+  int count=0;
+  const char* multis=OptValue(argc, argv, "--multis");
+  if (NULL == multis) {
+    for (int i = 0; i < NUMPSTATES; i++) {
+      entries[count++].multi=allpsi[i].multi;
+    }
+  } else {
+    char* end=(char*)multis;
+    while ('\0' != *end) {
+      if (count == NUMPSTATES) {
+        count++;//too many, reported below
+        break;
+      }
+      entries[count++].multi=strtod(end, &end);
+      if (',' == *end) {
+        end++;
+      } else if ('\0' != *end) {
+        fprintf(stderr, ERRORtext("!! search: bad --multis list") "\n");
+        return 2;
+      }
+    }
+  }
+  if (NUMPSTATES != count) {
+    fprintf(stderr, ERRORtext("!! search: --multis wants one multiplier per P-state, %d of them(P0 first; repeat one to use it in several slots)") "\n", NUMPSTATES);
+    return 2;
+  }
+  for (int i = 0; i < count; i++) {
+    if ((entries[i].multi < CPUMINMULTIunderclocked) || (entries[i].multi > CPUMAXMULTIunderclocked)) {
+      fprintf(stderr, ERRORtext("!! search: multi %.2f is outside %d..%d") "\n", entries[i].multi, CPUMINMULTIunderclocked, CPUMAXMULTIunderclocked);
+      return 2;
+    }
+    uint64_t bits=0;
+    if (!Codec().encode(entries[i].multi, CPUMAXVIDunderclocked, bits)) {
+      fprintf(stderr, ERRORtext("!! search: multi %.2f can't be set exactly") "\n", entries[i].multi);
+      return 2;
+    }
+    if ((i > 0) && (entries[i].multi > entries[i-1].multi)) {
+      fprintf(stderr, ERRORtext("!! search: --multis must go from fastest(P0) to slowest") "\n");
+      return 2;
+    }
+    entries[i].stablevid=-1;
+    entries[i].vid=-1;
+  }
+  char progress[4096];
+  snprintf(progress, sizeof(progress), "%s.progress", out);
+
+  uint64_t original[MAXCPUCORES];
+  Rdmsr(MSRPSTATEDEF0 + slot, original);
+  const int initialpstate=GetCurrentPState();
+  fprintf(stdout, "search: %d P-states in scratch P%d, %.0fs per candidate, stops at %.1fC, progress in %s, table goes to %s\n",
+      count, slot, seconds, maxtemp, progress, out);
+
+  int done=0;
+  bool aborted=false;
+  for (; (done < count) && !aborted; done++) {
+    SearchEntry& e=entries[done];
+    if ((done > 0) && (entries[done-1].multi == e.multi)) {
+      e=entries[done-1];//same multiplier in the next slot, nothing new to find out
+      WriteProgress(progress, entries, done + 1, margin);
+      continue;
+    }
+    //invariant: lo(higher voltage) is stable, hi(lower voltage) is not
+    int lo=CPUMAXVIDunderclocked;
+    int hi=CPUMINVIDunderclocked + 1;
+    int r=TryCandidate(slot, original, e.multi, lo, seconds, maxtemp, cooldown);
+    if (2 == r) {
+      aborted=true;
+      break;
+    }
+    if (1 == r) {
+      WriteProgress(progress, entries, done + 1, margin);
+      continue;
+    }
+    while (hi - lo > 1) {
+      const int mid=(lo + hi) / 2;
+      r=TryCandidate(slot, original, e.multi, mid, seconds, maxtemp, cooldown);
+      if (2 == r) {
+        aborted=true;
+        break;
+      }
+      if (0 == r) {
+        lo=mid;
+      } else {
+        hi=mid;
+      }
+    }
+    if (aborted) {
+      break;
+    }
+    e.stablevid=lo;
+    e.vid=std::max(CPUMAXVIDunderclocked, lo - margin);//lower VID is higher voltage
+    fprintf(stdout, "search: %.2fx stable down to %.4fV, using %.4fV(vid:%d)\n", e.multi, vid2voltage(lo), vid2voltage(e.vid), e.vid);
+    WriteProgress(progress, entries, done + 1, margin);
+  }
+
+  RestoreSlot(slot, original);
+  SetCurrentPState(initialpstate);
+  WriteProgress(progress, entries, done, margin);
+  if (aborted || (done < count)) {
+    fprintf(stderr, ERRORtext("!! search: stopped after %d of %d P-states, no table written(see %s)") "\n", done, count, progress);
+    return 1;
+  }
+  for (int i = 0; i < count; i++) {
+    if (entries[i].stablevid < 0) {
+      fprintf(stderr, ERRORtext("!! search: P%d(%.2fx) has no stable voltage, no table written(see %s)") "\n", i, entries[i].multi, progress);
+      return 1;
+    }
+  }
+  //a slower P-state must not get a higher voltage than a faster one(profile.h checks that too), so a faster slot gets at least the voltage of the slots below it
+  for (int i = count - 1; i > 0; i--) {
+    entries[i-1].vid=std::min(entries[i-1].vid, entries[i].vid);
+  }
+  if (!WriteTable(out, entries, margin)) {
+    return 1;
+  }
+  fprintf(stdout, "search: all %d P-states stable, table written to %s\n", count, out);
+  return 0;
+}
@@ -0,0 +1,8 @@
+#pragma once
+
+//automated voltage search: for each P-state's multiplier, bisects the VID between CPUMAXVIDunderclocked and CPUMINVIDunderclocked, checking every candidate with a stress run(see stress.h) in a scratch P-state, and writes out a ready-to-paste allpsi table with a safety margin added
+//family 12h only(the bounds are its VIDs and multipliers), refused on anything else
+//the table has one row per P-state in slot order and is only written if every slot found a stable voltage; the results so far go to <out>.progress after each multiplier
+//options: --multis=29,29,28,26,24,22,21,14(one per P-state, P0 first; default allpsi's) --slot=1 --seconds=60 --max-temp=90 --margin=2 --cooldown=5 --out=searched_allpsi.txt
+//returns the process exit code
+int RunSearch(const int argc, const char* argv[]);
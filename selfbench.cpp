@@ -0,0 +1,122 @@
+#include "selfbench.h"
+#include "mumu.h"
+#include "codec.h"
+#include "msr.h"
+#include "cores.h"
+#include "pstate.h"
+#include "boost.h"
+#include "profile.h"
+#include "snapshot.h"
+#include "apply.h"
+#include "options.h"
+#include "timing.h"
+
+#include <stdio.h>
+#include <string.h> //strcmp
+#include <algorithm> //std::sort
+#include <vector>
+
+//true if every core already has its profile, ie. an apply would write nothing
+static bool ProfilesApplied() {
+  PStateSnapshot snap;
+  if (!TakeSnapshot(snap)) {
+    return false;
+  }
+  for (int i = 0; i < snap.numcores; i++) {
+    const PStateWord* words=ProfileOfCpu(snap.cpu[i]).words;
+    for (int p = 0; p < NUMPSTATES; p++) {
+      if ((snap.pstatedef[p][i] & Codec().mask) != words[p].lo) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+//runs op iterations times and prints min/median/mean ns per call; op returns false on failure
+template <typename Op> static bool Measure(const char* name, const int iterations, Op op) {
+  std::vector<int64_t> ns(iterations);
+  for (int i = 0; i < iterations; i++) {
+    const int64_t start=NowNs();
+    if (!op(i)) {
+      fprintf(stderr, ERRORtext("!! selfbench: %s failed at iteration %d") "\n", name, i);
+      return false;
+    }
+    ns[i]=NowNs() - start;
+  }
+  int64_t total=0;
+  for (const int64_t n : ns) {
+    total += n;
+  }
+  std::sort(ns.begin(), ns.end());
+  fprintf(stdout, "%-28s %8d %12" PRId64 " %12" PRId64 " %12.0f\n", name, iterations, ns[0], ns[iterations / 2], (double)total / iterations);
+  fflush(stdout);
+  return true;
+}
+
+int RunSelfBench(const int argc, const char* argv[]) {
+  const int iterations=OptInt(argc, argv, "--iterations", 1000);
+  const bool simulated=(0 != strcmp("/dev/cpu/N/msr", MsrBackendName()));
+  const bool writes=simulated || HasArg(argc, argv, "--allow-writes");
+  if (iterations <= 0) {
+    fprintf(stderr, ERRORtext("!! selfbench: invalid options") "\n");
+    return 2;
+  }
+  //the applies write allpsi(and a variant of it), which is a family 12h table; the simulated cpu is one
+  if (writes && (CPUFAMILY != Codec().family)) {
+    fprintf(stderr, ERRORtext("!! selfbench: allpsi is a family 12h table, not writing it to this cpu(family %s)") "\n", Codec().name);
+    return 2;
+  }
+
+  //the rewriting apply alternates between the profiles and a copy with every voltage one step(12.5mV) higher, the safe direction
+  PStateWord higher[NUMPSTATES];
+  for (int p = 0; p < NUMPSTATES; p++) {
+    higher[p]=allpsiwords[p];
+    higher[p].vid=std::max(CPUMAXVIDunderclocked, higher[p].vid - 1);
+    if (writes && !Codec().encode(allpsi[p].multi, higher[p].vid, higher[p].lo)) {
+      fprintf(stderr, ERRORtext("!! selfbench: can't encode P%d one VID step higher") "\n", p);
+      return 2;
+    }
+  }
+
+  const int initialpstate=GetCurrentPState();
+  fprintf(stdout, "selfbench: %d cores via %s\n", NumCores(), MsrBackendName());
+  fprintf(stdout, "%-28s %8s %12s %12s %12s\n", "ns per op", "ops", "min", "median", "mean");
+  const int cpu=Core(0).cpu;
+  bool ok=true;
+  ok = ok && Measure("msr read(1 register)", iterations * 10, [cpu](int) {
+      uint64_t v;
+      return MsrRead(cpu, MSRCOFVIDSTATUS, v);
+      });
+  ok = ok && Measure("snapshot(all cores)", iterations, [](int) {
+      PStateSnapshot snap;
+      return TakeSnapshot(snap);
+      });
+  ApplySummary summary;
+  if (writes) {
+    ok = ok && ApplyCoreProfiles(summary);//so the next one has nothing to write
+  }
+  if (ProfilesApplied()) {
+    ok = ok && Measure("apply(nothing to write)", iterations, [](int) {
+        ApplySummary s;
+        return ApplyCoreProfiles(s) && (0 == s.written);
+        });
+  } else {
+    fprintf(stdout, "%-28s (skipped: the profiles aren't applied, add --allow-writes)\n", "apply(nothing to write)");
+  }
+  if (writes) {
+    ok = ok && Measure("apply(all rewritten)", iterations, [&higher](int i) {
+        ApplySummary s;
+        return ApplyProfile((0 == i % 2) ? higher : allpsiwords, s);
+        });
+    ok = ok && ApplyCoreProfiles(summary);//back to the real ones
+  } else {
+    fprintf(stdout, "%-28s (skipped: real msrs, add --allow-writes)\n", "apply(all rewritten)");
+  }
+  ok = ok && Measure("transition + wait(all cores)", iterations, [](int i) {
+      return SetCurrentPState((0 == i % 2) ? NUMPSTATES - 1 : SwToHw(0));
+      });
+
+  SetCurrentPState(initialpstate);
+  return (ok ? 0 : 1);
+}
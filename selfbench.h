@@ -0,0 +1,7 @@
+#pragma once
+
+//benchmarks the tool's own costs, per operation: a single msr read, a full snapshot of all cores, an apply with nothing to write, an apply that rewrites every definition, and a P-state transition including the wait for the acknowledge
+//best run with --sim first(no real msrs, and the rewriting apply only runs there or with --allow-writes, which is refused on anything but family 12h), then on the real cpu to see what the msr driver adds
+//options: --iterations=1000 --allow-writes
+//returns the process exit code
+int RunSelfBench(const int argc, const char* argv[]);
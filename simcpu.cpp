@@ -0,0 +1,280 @@
+#include "simcpu.h"
+#include "mumu.h"
+#include "msr.h"
+#include "cores.h"
+#include "thermal.h"
+#include "profile.h"
+#include "snapshot.h" //for the MSR* register indexes
+#include "options.h"
+#include "timing.h"
+#include "codec.h"
+#include "boost.h"
+
+#include <errno.h>
+#include <math.h> //exp
+#include <stdlib.h> //getenv
+#include <string.h>
+#include <mutex>
+
+#define SIMMSRTSC 0x10
+#define SIMMSRMPERF 0xe7
+#define SIMMSRAPERF 0xe8
+#define SIMHWCRDEFAULT 0x1000010ULL //TscFreqSel and McStatusWrEn, like a fresh boot
+
+struct SimCore {
+  std::mutex lock;
+  uint64_t pstatedef[NUMPSTATES];
+  uint64_t control; //software numbering, as written
+  uint64_t hwcr;
+  int from; //hardware numbering: running until transitiondone, then 'to' is
+  int to;
+  uint64_t fromlo; //the definitions latched when each transition started: fid/did/vid as COFVID reports them
+  uint64_t tolo;
+  int64_t transitiondone;
+  double load;
+  double tsc, mperf, aperf; //counters, advanced lazily on every access
+  int64_t countersns;
+  uint32_t failwrite; //the next write to this register fails(SimFailNextWrite()), 0 for none
+};
+
+class SimFamily12h : public MsrBackend {
+  SimCore core[SIMNUMCORES];
+  std::mutex thermallock;
+  double temp;
+  int64_t tempns;
+
+  static int Running(const SimCore& c, const int64_t now) {
+    return (now >= c.transitiondone ? c.to : c.from);
+  }
+
+  static double MultiOf(const uint64_t lo) {
+    return Codec12h::Multi(lo);
+  }
+
+  static double VoltageOf(const uint64_t lo) {
+    return Codec12h::VidToVoltage(Codec12h::Vid(lo));
+  }
+
+  //both called with c.lock held
+  void AdvanceCounters(SimCore& c, const int64_t now) {
+    const double us=(now - c.countersns) / 1000.0;
+    const int running=Running(c, now);
+    const double mhz=MultiOf(running == c.to ? c.tolo : c.fromlo) * DEFAULTREFERENCECLOCK;
+    c.tsc += us * SIMTSCMHZ;
+    c.mperf += us * SIMTSCMHZ * c.load;
+    c.aperf += us * mhz * c.load;
+    c.countersns=now;
+  }
+
+  int64_t TransitionNs(const uint64_t fromlo, const uint64_t tolo) {
+    const int dvid=Codec12h::Vid(fromlo) - Codec12h::Vid(tolo);
+    return SIMTRANSITIONBASENS + (dvid < 0 ? -dvid : dvid) * SIMVIDSTEPNS;
+  }
+
+  //the hardware P-state the core should be heading for: the request, clamped to PstateMaxVal and by HTC, boosted from software P0 when CPB allows
+  static int Target(const SimCore& c, const double temp) {
+    int sw=GetBits(c.control, 0, 3);
+    if ((sw > NUMPSTATES - 1 - SIMNUMBOOSTSTATES) || (temp >= SIMHTCTEMPC)) {
+      sw=NUMPSTATES - 1 - SIMNUMBOOSTSTATES;//beyond PstateMaxVal, or HTC
+    }
+    const double boostbelow=SIMBOOSTTEMPC - (c.to < SIMNUMBOOSTSTATES ? 0 : SIMBOOSTHYSTERESISC);
+    if ((0 == sw) && (0 == GetBits(c.hwcr, HWCRCPBDIS, 1)) && (temp < boostbelow)) {
+      return 0;
+    }
+    return sw + SIMNUMBOOSTSTATES;
+  }
+
+  //with c.lock held
+  void StartTransition(SimCore& c, const int64_t now, const int to) {
+    AdvanceCounters(c, now);
+    const int running=Running(c, now);
+    c.fromlo=(running == c.to ? c.tolo : c.fromlo);
+    c.from=running;
+    c.to=to;
+    c.tolo=c.pstatedef[c.to] & PSTATELOWMASK;
+    c.transitiondone=now + TransitionNs(c.fromlo, c.tolo);
+  }
+
+  //boosting and HTC change with the temperature while the request stays the same: a core that's done with its last transition starts the next one by itself
+  void Retarget(SimCore& c, const int64_t now, const double temp) {
+    const int target=Target(c, temp);
+    if ((now >= c.transitiondone) && (target != c.to)) {
+      StartTransition(c, now, target);
+    }
+  }
+
+public:
+
+  SimFamily12h() : temp(SIMAMBIENTC), tempns(0) {
+    const int64_t now=NowNs();
+    tempns=now;
+    for (int i = 0; i < SIMNUMCORES; i++) {
+      SimCore& c=core[i];
+      for (int p = 0; p < NUMPSTATES; p++) {
+        c.pstatedef[p]=(1ULL << 63) | EncodePState(bootdefaults_psi[p]).lo;//PstateEn; fid/did/vid are encoded even though the boot table isn't a valid underclocking one
+      }
+      c.control=0;
+      c.hwcr=SIMHWCRDEFAULT;
+      c.to=SIMNUMBOOSTSTATES;
+      c.from=c.to=Target(c, temp);//software P0 requested, so boosting
+      c.fromlo=c.tolo=c.pstatedef[c.to] & PSTATELOWMASK;
+      c.transitiondone=now;
+      c.load=1.0;
+      c.tsc=c.mperf=c.aperf=0;
+      c.countersns=now;
+      c.failwrite=0;
+    }
+  }
+
+  const char* Name() const override { return "simulated family 12h"; }
+
+  bool Open(const int cpu) override {
+    if ((cpu < 0) || (cpu >= SIMNUMCORES)) {
+      errno=ENXIO;
+      return false;
+    }
+    return true;
+  }
+
+  void Close(const int) override {}
+
+  //power of all cores right now, C*V^2*f like the energy mode's model
+  double PowerWatts(const int64_t now) {
+    double watts=0;
+    for (int i = 0; i < SIMNUMCORES; i++) {
+      std::lock_guard<std::mutex> lock(core[i].lock);
+      const SimCore& c=core[i];
+      const uint64_t lo=(Running(c, now) == c.to ? c.tolo : c.fromlo);
+      const double v=VoltageOf(lo);
+      watts += 2.17e-9 * v * v * MultiOf(lo) * DEFAULTREFERENCECLOCK * 1e6 * c.load;
+    }
+    return watts;
+  }
+
+  double Temperature() {
+    const int64_t now=NowNs();
+    const double watts=PowerWatts(now);
+    std::lock_guard<std::mutex> lock(thermallock);
+    const double target=SIMAMBIENTC + watts * SIMTHERMALRESISTANCE;
+    temp += (target - temp) * (1.0 - exp(-(double)(now - tempns) / SIMTHERMALTAUNS));
+    tempns=now;
+    return temp;
+  }
+
+  void SetLoad(const int cpu, const double load) {
+    if ((cpu < 0) || (cpu >= SIMNUMCORES)) {
+      return;
+    }
+    Temperature();//settle the temperature at the old load first
+    std::lock_guard<std::mutex> lock(core[cpu].lock);
+    AdvanceCounters(core[cpu], NowNs());
+    core[cpu].load=(load < 0 ? 0 : (load > 1 ? 1 : load));
+  }
+
+  void FailNextWrite(const int cpu, const uint32_t regIndex) {
+    if ((cpu < 0) || (cpu >= SIMNUMCORES)) {
+      return;
+    }
+    std::lock_guard<std::mutex> lock(core[cpu].lock);
+    core[cpu].failwrite=regIndex;
+  }
+
+  bool Read(const int cpu, const uint32_t regIndex, uint64_t& value) override {
+    if (!Open(cpu)) {
+      return false;
+    }
+    const bool defs=(regIndex >= MSRPSTATEDEF0) && (regIndex < MSRPSTATEDEF0 + NUMPSTATES);
+    const double temp=(defs ? 0 : Temperature());//the definitions are what the snapshots read, keep those cheap
+    SimCore& c=core[cpu];
+    std::lock_guard<std::mutex> lock(c.lock);
+    const int64_t now=NowNs();
+    if (!defs) {
+      Retarget(c, now, temp);
+    }
+    const int running=Running(c, now);
+    if (defs) {
+      value=c.pstatedef[regIndex - MSRPSTATEDEF0];
+    } else if (MSRPSTATELIMIT == regIndex) {
+      const int maxval=NUMPSTATES - 1 - SIMNUMBOOSTSTATES;
+      value=((uint64_t)maxval << 4) | (temp >= SIMHTCTEMPC ? maxval : 0);//PstateMaxVal, CurPstateLimit; software numbering
+    } else if (MSRPSTATECONTROL == regIndex) {
+      value=c.control;
+    } else if (MSRPSTATESTATUS == regIndex) {
+      value=(uint64_t)(running < SIMNUMBOOSTSTATES ? 0 : running - SIMNUMBOOSTSTATES);//boosting is software P0
+    } else if (MSRCOFVIDSTATUS == regIndex) {
+      const uint64_t lo=(running == c.to ? c.tolo : c.fromlo);
+      value=((uint64_t)running << 16) | (lo & PSTATELOWMASK);//CurPstate, CurCpuVid/Fid/Did
+    } else if (MSRHWCR == regIndex) {
+      value=c.hwcr;
+    } else if ((SIMMSRTSC == regIndex) || (SIMMSRMPERF == regIndex) || (SIMMSRAPERF == regIndex)) {
+      AdvanceCounters(c, now);
+      value=(uint64_t)(SIMMSRTSC == regIndex ? c.tsc : (SIMMSRMPERF == regIndex ? c.mperf : c.aperf));
+    } else {
+      errno=EIO;//what the msr driver says for a register the cpu doesn't have
+      return false;
+    }
+    return true;
+  }
+
+  bool Write(const int cpu, const uint32_t regIndex, const uint64_t value) override {
+    if (!Open(cpu)) {
+      return false;
+    }
+    const double temp=(MSRPSTATECONTROL == regIndex ? Temperature() : 0);
+    SimCore& c=core[cpu];
+    std::lock_guard<std::mutex> lock(c.lock);
+    const int64_t now=NowNs();
+    if ((0 != c.failwrite) && (regIndex == c.failwrite)) {
+      c.failwrite=0;
+      errno=EIO;
+      return false;
+    }
+    if ((regIndex >= MSRPSTATEDEF0) && (regIndex < MSRPSTATEDEF0 + NUMPSTATES)) {
+      c.pstatedef[regIndex - MSRPSTATEDEF0]=value;//not latched into COFVID until the next transition
+    } else if (MSRPSTATECONTROL == regIndex) {
+      c.control=(c.control & ~7ULL) | (uint64_t)GetBits(value, 0, 3);
+      StartTransition(c, now, Target(c, temp));
+    } else if (MSRHWCR == regIndex) {
+      c.hwcr=value;
+    } else {
+      errno=EIO;//read-only(0xc0010061, the status registers, the counters) or nonexistent
+      return false;
+    }
+    return true;
+  }
+};
+
+static SimFamily12h* sim=NULL;
+
+static bool SimReadTemperature(double& degC) {
+  degC=sim->Temperature();
+  return true;
+}
+
+bool SimRequested(const int argc, const char* argv[]) {
+  const char* env=getenv("AMDMSRT_SIM");
+  return HasArg(argc, argv, "--sim") || ((NULL != env) && ('\0' != env[0]) && (0 != strcmp("0", env)));
+}
+
+void SimActivate() {
+  if (NULL == sim) {
+    sim=new SimFamily12h();//lives until exit, the per-core threads may still be using it from atexit handlers
+  }
+  SetMsrBackend(sim);
+  SetSimulatedTopology(SIMNUMCORES);
+  SetTemperatureSource(SimReadTemperature, "simulated family 12h die");
+  SetNumBoostStates(SIMNUMBOOSTSTATES, "the simulated family 12h cpu");
+  SelectCodec(CPUFAMILY, CPUMODEL);
+}
+
+void SimSetLoad(const int cpu, const double load) {
+  if (NULL != sim) {
+    sim->SetLoad(cpu, load);
+  }
+}
+
+void SimFailNextWrite(const int cpu, const uint32_t regIndex) {
+  if (NULL != sim) {
+    sim->FailNextWrite(cpu, regIndex);
+  }
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+//an in-memory family 12h cpu(A6-3400M like: 4 cores, the bootdefaults_psi table) behind the msr backend interface(see msr.h), so every mode can run without /dev/cpu/N/msr and without any risk to real hardware
+//what it models, per core: the 8 P-state definitions(hardware P0 is the boost state), 0xc0010061 limit(read-only, HTC clamps to the slowest P-state when hot), 0xc0010062 control and 0xc0010063 status,
+//COFVID status(0xc0010071, latching the definition at the start of each transition like the hardware does, so a rewritten active P-state only takes effect after a switch),
+//a transition delay growing with the voltage step, HWCR, and TSC/MPERF/APERF counting at the running frequency times a per-core load
+//CPB: hardware P0 is the one boost state; a core requesting software P0 with HWCR CpbDis clear runs in it while the die is below SIMBOOSTTEMPC, and drops out of it(and back in) on its own
+//shared: one die temperature, first order RC response to the C*V^2*f power of all cores
+//selected with --sim on the command line or AMDMSRT_SIM=1 in the environment
+
+#include <stdint.h>
+
+#define SIMNUMCORES 4
+#define SIMTRANSITIONBASENS 15000 //fixed part of a P-state transition
+#define SIMVIDSTEPNS 1000 //plus this per VID step(12.5mV) of voltage ramp
+#define SIMAMBIENTC 45.0
+#define SIMTHERMALRESISTANCE 1.2 //degC per W, die to ambient
+#define SIMTHERMALTAUNS 2000000000LL //RC time constant
+#define SIMHTCTEMPC 95.0 //hardware thermal control limit
+#define SIMNUMBOOSTSTATES 1
+#define SIMBOOSTTEMPC 85.0 //no boosting at or above this
+#define SIMBOOSTHYSTERESISC 3.0 //and back into boost only this far below it
+#define SIMTSCMHZ 1400 //TSC/MPERF rate, the boot default non-boost P0
+
+//true if --sim was given(before any "--") or AMDMSRT_SIM is set to something else than 0
+bool SimRequested(const int argc, const char* argv[]);
+//switches the msr backend, the topology and the temperature source over to the simulated cpu(before DiscoverTopology()/MsrOpenAll())
+void SimActivate();
+//fraction of time(0..1) a simulated core is busy, drives APERF/MPERF and the temperature; default 1
+void SimSetLoad(const int cpu, const double load);
+//makes that core's next write to regIndex fail(EIO) without changing it, once; for testing the failure paths(see check.cpp)
+void SimFailNextWrite(const int cpu, const uint32_t regIndex);
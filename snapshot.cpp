@@ -0,0 +1,62 @@
+#include "snapshot.h"
+#include "msr.h"
+#include "profile.h"
+#include "telemetry.h"
+
+#include <stdio.h>
+#include <string.h> //memset
+
+bool TakeSnapshot(PStateSnapshot& snap) {
+  memset(&snap, 0, sizeof(snap));
+  snap.numcores=NumCores();
+  RunOnEachCore([&snap](int core) {
+      const int cpu=Core(core).cpu;
+      snap.cpu[core]=cpu;
+      bool ok=true;
+      for (int p = 0; p < NUMPSTATES; p++) {
+        ok = MsrRead(cpu, MSRPSTATEDEF0 + p, snap.pstatedef[p][core]) && ok;
+      }
+      ok = MsrRead(cpu, MSRCOFVIDSTATUS, snap.cofvidstatus[core]) && ok;
+      ok = MsrRead(cpu, MSRPSTATESTATUS, snap.pstatestatus[core]) && ok;
+      snap.ok[core]=ok;//each thread only touches its own core's column
+      });
+
+  bool allok=true;
+  for (int i = 0; i < snap.numcores; i++) {
+    allok = allok && snap.ok[i];
+  }
+  TelemetrySnapshot(snap);
+  return allok;
+}
+
+int CheckSnapshot(const PStateSnapshot& snap) {
+  int mismatches=0;
+  for (int i = 0; i < snap.numcores; i++) {
+    if (!snap.ok[i]) {
+      fprintf(stderr, ERRORtext("!! Snapshot: failed to read msrs of cpu %d") "\n", snap.cpu[i]);
+    }
+  }
+
+  for (int p = 0; p < NUMPSTATES; p++) {
+    for (int i = 1; i < snap.numcores; i++) {
+      //compare with the first core that has the same profile, a core with its own table is expected to differ from the rest
+      int j=0;
+      while ((j < i) && (ProfileOfCpu(snap.cpu[j]).words != ProfileOfCpu(snap.cpu[i]).words)) {
+        j++;
+      }
+      if ((j < i) && (snap.pstatedef[p][j] != snap.pstatedef[p][i])) {
+        mismatches++;
+        fprintf(stderr, ERRORtext("!! Snapshot: P%d definition differs between cores") " cpu[%d]==%016" PRIx64 " != cpu[%d]==%016" PRIx64 "\n",
+            p, snap.cpu[j], snap.pstatedef[p][j], snap.cpu[i], snap.pstatedef[p][i]);
+      }
+    }
+  }
+
+  for (int i = 1; i < snap.numcores; i++) {
+    if ((snap.cofvidstatus[i-1] != snap.cofvidstatus[i]) || (snap.pstatestatus[i-1] != snap.pstatestatus[i])) {
+      fprintf(stdout, startYELLOWcolortext "  !! Snapshot: cpu[%d] and cpu[%d] are in different states(this is expected to be so depending on load) cofvid:%016" PRIx64 "/%016" PRIx64 " pstatestatus:%" PRIu64 "/%" PRIu64 endcolor "\n",
+          snap.cpu[i-1], snap.cpu[i], snap.cofvidstatus[i-1], snap.cofvidstatus[i], snap.pstatestatus[i-1], snap.pstatestatus[i]);
+    }
+  }
+  return mismatches;
+}
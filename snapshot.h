@@ -0,0 +1,28 @@
+#pragma once
+
+#include "mumu.h"
+#include "cores.h"
+
+#define MSRPSTATEDEF0 0xc0010064 //P0 definition, P1..P7 follow: 0xc0010064 + numpstate
+#define MSRPSTATELIMIT 0xc0010061 //read-only: CurPstateLimit(bits 2:0) and PstateMaxVal(bits 6:4), software numbering
+#define MSRPSTATECONTROL 0xc0010062
+#define MSRPSTATESTATUS 0xc0010063
+#define MSRCOFVIDSTATUS 0xc0010071
+
+//one register dump of every online core, taken in one parallel pass(struct-of-arrays, indexed [register][core index], see cores.h)
+struct PStateSnapshot {
+  int numcores; //how many of the columns below are used
+  int cpu[MAXCPUCORES]; //logical cpu number of each column
+  uint64_t pstatedef[NUMPSTATES][MAXCPUCORES]; //0xc0010064..0xc001006b
+  uint64_t cofvidstatus[MAXCPUCORES]; //0xc0010071
+  uint64_t pstatestatus[MAXCPUCORES]; //0xc0010063
+  bool ok[MAXCPUCORES]; //false if any read failed for that core(its values are then 0)
+};
+
+//reads all 10 registers of each core from a thread pinned to that core, all cores at the same time
+//returns false if any read failed
+bool TakeSnapshot(PStateSnapshot& snap);
+
+//cross-core check of an already taken snapshot(no extra reads): P-state definitions must be the same on all cores that use the same profile(see ProfileOfCpu() in profile.h), current P-state/COFVID differences are only reported because they are expected depending on load
+//returns the number of P-state definitions that differ between such cores
+int CheckSnapshot(const PStateSnapshot& snap);
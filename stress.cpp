@@ -0,0 +1,149 @@
+#include "stress.h"
+#include "mumu.h"
+#include "kernels.h"
+#include "pstate.h"
+#include "boost.h"
+#include "cores.h"
+#include "thermal.h"
+#include "options.h"
+#include "timing.h"
+
+#include <stdio.h>
+#include <stdlib.h> //aligned_alloc
+#include <string.h>
+#include <unistd.h> //usleep
+#include <atomic>
+#include <thread>
+
+static uint64_t references[NUMSTRESSKERNELS];
+static bool havereferences=false;
+
+static bool ComputeReferences() {
+  if (havereferences) {
+    return true;
+  }
+  void* buf=aligned_alloc(64, KERNELMAXBYTES);
+  if (NULL == buf) {
+    return false;
+  }
+  SetCurrentPState(NUMPSTATES - 1);//slowest, ie. the one with the most voltage margin
+  for (int k = 0; k < NUMSTRESSKERNELS; k++) {
+    references[k]=stresskernels[k].fn(buf, stresskernels[k].bytes, stresskernels[k].rounds);
+  }
+  free(buf);
+  havereferences=true;
+  return true;
+}
+
+bool StressCores(const int pstate, const double seconds, const double maxtemp, const bool stoponerror, StressResult& result) {
+  memset(&result, 0, sizeof(result));
+  result.numcores=NumCores();
+  result.peaktemp=-1.0;
+
+  const int initialpstate=GetCurrentPState();
+  if (!ComputeReferences()) {
+    return false;
+  }
+  bool cpbwas=false;
+  if (!GetCpb(Core(0).cpu, cpbwas) || !SetCpbForPState(pstate) || !SetCurrentPState(pstate)) {
+    SetCpb(cpbwas);
+    SetCurrentPState(initialpstate);
+    return false;
+  }
+
+  std::atomic<bool> stop(false);
+  std::atomic<bool> outofmemory(false);
+  const bool havethermal=ThermalOpen();
+  const int64_t start=NowNs();
+  const int64_t deadline=start + (int64_t)(seconds * 1e9);
+
+  //watches the temperature while the cores are busy, and ends the run at the deadline
+  std::thread watcher([&]() {
+      while (!stop.load()) {
+        double temp;
+        if (havethermal && ReadTemperature(temp)) {
+          if (temp > result.peaktemp) {
+            result.peaktemp=temp;
+          }
+          if (temp >= maxtemp) {
+            result.overheated=true;
+            stop.store(true);
+          }
+        }
+        if (NowNs() >= deadline) {
+          stop.store(true);
+        }
+        usleep(50000);
+      }
+      });
+
+  RunOnEachCore([&](int i) {
+      result.cpu[i]=Core(i).cpu;
+      void* buf=aligned_alloc(64, KERNELMAXBYTES);
+      if (NULL == buf) {
+        outofmemory.store(true);
+        return;
+      }
+      while (!stop.load(std::memory_order_relaxed)) {
+        for (int k = 0; (k < NUMSTRESSKERNELS) && !stop.load(std::memory_order_relaxed); k++) {
+          const uint64_t sum=stresskernels[k].fn(buf, stresskernels[k].bytes, stresskernels[k].rounds);
+          if (sum == references[k]) {
+            result.passes[i]++;
+          } else {
+            result.errors[i]++;
+            fprintf(stderr, ERRORtext("!! stress: cpu%d %s checksum %016" PRIx64 " != %016" PRIx64) "\n",
+                result.cpu[i], stresskernels[k].name, sum, references[k]);
+            if (stoponerror) {
+              stop.store(true);//one failing core is enough to reject the P-state
+              free(buf);
+              return;
+            }
+          }
+        }
+      }
+      free(buf);
+      });
+  stop.store(true);
+  watcher.join();
+  result.seconds=(NowNs() - start) / 1e9;
+
+  SetCpb(cpbwas);
+  SetCurrentPState(initialpstate);
+  return !outofmemory.load();
+}
+
+int RunStress(const int argc, const char* argv[]) {
+  const int pstate=OptInt(argc, argv, "--pstate", 0);
+  const double seconds=OptDouble(argc, argv, "--seconds", 60.0);
+  const double maxtemp=OptDouble(argc, argv, "--max-temp", 95.0);
+  if ((pstate < 0) || (pstate >= NUMPSTATES) || (seconds <= 0)) {
+    fprintf(stderr, ERRORtext("!! stress: invalid options") "\n");
+    return 2;
+  }
+
+  fprintf(stdout, "stress: P%d on %d cores for %.0fs(stops at %.1fC), kernels:", pstate, NumCores(), seconds, maxtemp);
+  for (int k = 0; k < NUMSTRESSKERNELS; k++) {
+    fprintf(stdout, " %s", stresskernels[k].name);
+  }
+  fprintf(stdout, "\n");
+
+  StressResult result;
+  if (!StressCores(pstate, seconds, maxtemp, false, result)) {
+    fprintf(stderr, ERRORtext("!! stress: failed to run(out of memory or P-state not set)") "\n");
+    return 3;
+  }
+
+  bool anyerror=false;
+  for (int i = 0; i < result.numcores; i++) {
+    fprintf(stdout, "  cpu%d: %" PRIu64 " passes, %" PRIu64 " errors%s\n", result.cpu[i], result.passes[i], result.errors[i],
+        (result.errors[i] > 0 ? "  <-- FAIL" : ""));
+    anyerror = anyerror || (result.errors[i] > 0);
+  }
+  if (result.peaktemp < 0) {
+    fprintf(stdout, "elapsed: %.1fs, peak temperature: unknown\n", result.seconds);
+  } else {
+    fprintf(stdout, "elapsed: %.1fs, peak temperature: %.1fC%s\n", result.seconds, result.peaktemp,
+        (result.overheated ? " (stopped early, too hot)" : ""));
+  }
+  return (anyerror ? 1 : 0);
+}
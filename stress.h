@@ -0,0 +1,25 @@
+#pragma once
+
+#include "cores.h"
+
+#include <inttypes.h>
+
+struct StressResult {
+  int numcores;
+  int cpu[MAXCPUCORES];
+  uint64_t passes[MAXCPUCORES]; //kernel runs whose checksum matched the reference
+  uint64_t errors[MAXCPUCORES]; //kernel runs whose checksum didn't
+  double seconds; //actual run time
+  double peaktemp; //degC, -1 if no temperature source
+  bool overheated; //stopped early because maxtemp was reached
+};
+
+//runs the checksum-verified kernel mix(see kernels.h) on every core at once, each from a thread pinned to it, at P-state pstate(hardware numbering, like SetCurrentPState) for that many seconds or until maxtemp(degC) is reached
+//the reference checksums are computed once per process, at the slowest P-state
+//stops all cores on the first error if stoponerror; puts back the P-state that was current before
+//returns false if it could not run at all(eg. out of memory, or the P-state could not be set)
+bool StressCores(const int pstate, const double seconds, const double maxtemp, const bool stoponerror, StressResult& result);
+
+//the stress mode: --pstate=0 --seconds=60 --max-temp=95
+//returns the process exit code(1 if any core had an error)
+int RunStress(const int argc, const char* argv[]);
@@ -0,0 +1,196 @@
+#include "telemetry.h"
+#include "mumu.h"
+#include "snapshot.h"
+#include "timing.h"
+#include "boost.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h> //atexit
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <mutex>
+#include <string>
+#include <thread>
+
+std::atomic<int> telemetryclients(0);
+
+static int listenfd=-1;
+static char listenpath[sizeof(((struct sockaddr_un*)0)->sun_path)];
+static std::thread sender;
+static std::atomic<bool> stopsender(false);
+static std::mutex batchlock;
+static std::string batch;//guarded by batchlock
+static uint64_t droppedevents=0;//guarded by batchlock
+
+static void Publish(const char* line, const int len) {
+  if (len <= 0) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(batchlock);
+  if (batch.size() + len > TELEMETRYMAXBATCH) {
+    droppedevents++;
+    return;
+  }
+  batch.append(line, len);
+}
+
+//the sender thread owns the client fds, the event producers only ever touch the batch
+static void SendLoop() {
+  int clients[TELEMETRYMAXCLIENTS];
+  int numclients=0;
+  std::string out;
+  while (!stopsender) {
+    struct pollfd pfds[1 + TELEMETRYMAXCLIENTS];
+    pfds[0] = { listenfd, POLLIN, 0 };
+    for (int i = 0; i < numclients; i++) {
+      pfds[1 + i] = { clients[i], POLLIN, 0 };//a client never sends anything, so readable means it hung up
+    }
+    poll(pfds, 1 + numclients, TELEMETRYBATCHMS);
+
+    for (int i = numclients - 1; i >= 0; i--) {
+      if (0 != pfds[1 + i].revents) {
+        close(clients[i]);
+        clients[i]=clients[--numclients];
+      }
+    }
+    if (pfds[0].revents & POLLIN) {
+      const int fd=accept4(listenfd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+      if ((-1 != fd) && (numclients < TELEMETRYMAXCLIENTS)) {
+        clients[numclients++]=fd;
+      } else if (-1 != fd) {
+        close(fd);
+      }
+    }
+    telemetryclients=numclients;
+
+    uint64_t dropped;
+    {
+      std::lock_guard<std::mutex> lock(batchlock);
+      out.swap(batch);
+      batch.clear();
+      dropped=droppedevents;
+      droppedevents=0;
+    }
+    if (dropped > 0) {
+      char line[96];
+      out.append(line, snprintf(line, sizeof(line), "{\"ns\":%" PRId64 ",\"ev\":\"dropped\",\"count\":%" PRIu64 "}\n", NowNs(), dropped));
+    }
+    if (out.empty() || (0 == numclients)) {
+      continue;
+    }
+    for (int i = numclients - 1; i >= 0; i--) {
+      //a client that can't take a whole batch right away is too slow, it gets disconnected instead of stalling everyone
+      if ((ssize_t)out.size() != send(clients[i], out.data(), out.size(), MSG_NOSIGNAL | MSG_DONTWAIT)) {
+        close(clients[i]);
+        clients[i]=clients[--numclients];
+      }
+    }
+    telemetryclients=numclients;
+  }
+  for (int i = 0; i < numclients; i++) {
+    close(clients[i]);
+  }
+  telemetryclients=0;
+}
+
+bool TelemetryOpen(const char* path) {
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family=AF_UNIX;
+  if ((-1 != listenfd) || (strlen(path) >= sizeof(addr.sun_path))) {
+    return false;
+  }
+  strcpy(addr.sun_path, path);
+  listenfd=socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (-1 == listenfd) {
+    return false;
+  }
+  unlink(path);//left over from a previous run that got killed
+  if ((0 != bind(listenfd, (struct sockaddr*)&addr, sizeof(addr))) || (0 != listen(listenfd, TELEMETRYMAXCLIENTS))) {
+    close(listenfd);
+    listenfd=-1;
+    return false;
+  }
+  strcpy(listenpath, path);
+  stopsender=false;
+  sender=std::thread(SendLoop);
+  atexit(TelemetryClose);
+  return true;
+}
+
+void TelemetryClose() {
+  if (-1 == listenfd) {
+    return;
+  }
+  stopsender=true;
+  sender.join();//its last pass already went out, whatever came after is lost
+  close(listenfd);
+  listenfd=-1;
+  unlink(listenpath);
+}
+
+void TelemetryRequest(const int cpu, const int pstate, const int64_t latencyns) {
+  if (!TelemetryActive()) {
+    return;
+  }
+  char line[128];
+  Publish(line, snprintf(line, sizeof(line), "{\"ns\":%" PRId64 ",\"ev\":\"request\",\"cpu\":%d,\"pstate\":%d,\"lat_ns\":%" PRId64 "}\n",
+        NowNs(), cpu, pstate, latencyns));
+}
+
+void TelemetryTransition(const int cpu, const int from, const int to, const int64_t ns) {
+  if (!TelemetryActive()) {
+    return;
+  }
+  char line[128];
+  Publish(line, snprintf(line, sizeof(line), "{\"ns\":%" PRId64 ",\"ev\":\"transition\",\"cpu\":%d,\"from\":%d,\"to\":%d}\n",
+        ns, cpu, from, to));
+}
+
+void TelemetryTemperature(const double celsius) {
+  if (!TelemetryActive()) {
+    return;
+  }
+  char line[96];
+  Publish(line, snprintf(line, sizeof(line), "{\"ns\":%" PRId64 ",\"ev\":\"temp\",\"c\":%.3f}\n", NowNs(), celsius));
+}
+
+void TelemetryApply(const int cores, const int differing, const int written, const int switched, const int errors, const bool rolledback) {
+  if (!TelemetryActive()) {
+    return;
+  }
+  char line[192];
+  Publish(line, snprintf(line, sizeof(line), "{\"ns\":%" PRId64 ",\"ev\":\"apply\",\"cores\":%d,\"differing\":%d,\"written\":%d,\"switched\":%d,\"errors\":%d,\"rolledback\":%s}\n",
+        NowNs(), cores, differing, written, switched, errors, (rolledback ? "true" : "false")));
+}
+
+void TelemetryBoost(const bool enabled, const int errors) {
+  if (!TelemetryActive()) {
+    return;
+  }
+  char line[128];
+  Publish(line, snprintf(line, sizeof(line), "{\"ns\":%" PRId64 ",\"ev\":\"boost\",\"enabled\":%s,\"errors\":%d}\n",
+        NowNs(), (enabled ? "true" : "false"), errors));
+}
+
+void TelemetrySnapshot(const PStateSnapshot& snap) {
+  if (!TelemetryActive()) {
+    return;
+  }
+  const int64_t ns=NowNs();
+  for (int i = 0; i < snap.numcores; i++) {
+    char line[512];
+    int len=snprintf(line, sizeof(line), "{\"ns\":%" PRId64 ",\"ev\":\"snapshot\",\"cpu\":%d,\"ok\":%s,\"running\":%u,\"acknowledged\":%d,\"defs\":[",
+        ns, snap.cpu[i], (snap.ok[i] ? "true" : "false"), GetBits(snap.cofvidstatus[i], 16, 3),
+        SwToHw(GetBits(snap.pstatestatus[i], 0, 3)));
+    for (int p = 0; p < NUMPSTATES; p++) {
+      len += snprintf(line + len, sizeof(line) - len, "%s\"0x%016" PRIx64 "\"", (0 == p ? "" : ","), snap.pstatedef[p][i]);
+    }
+    len += snprintf(line + len, sizeof(line) - len, "]}\n");
+    Publish(line, len);
+  }
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <atomic>
+#include <inttypes.h>
+
+//structured telemetry for collectors: JSON lines(one event per line, "ns" is CLOCK_MONOTONIC) sent in batches every TELEMETRYBATCHMS to every client connected to a local unix stream socket
+//nothing gets formatted while nobody is connected: every Telemetry*() returns right away unless TelemetryActive()
+//events:
+//  {"ns":..,"ev":"request","cpu":0,"pstate":3,"lat_ns":41000}  a P-state request and its write-to-acknowledge latency(-1 msr failure, -2 timeout), hardware numbering
+//  {"ns":..,"ev":"transition","cpu":0,"from":1,"to":3}  a P-state change seen by the sampler
+//  {"ns":..,"ev":"temp","c":71.250}
+//  {"ns":..,"ev":"apply","cores":4,"differing":8,"written":8,"switched":1,"errors":0,"rolledback":false}
+//  {"ns":..,"ev":"boost","enabled":true,"errors":0}  CPB switched on or off on all cores
+//  {"ns":..,"ev":"snapshot","cpu":0,"ok":true,"running":3,"acknowledged":3,"defs":["0x..",..]}  one per core
+
+#define TELEMETRYBATCHMS 50
+#define TELEMETRYMAXBATCH (256*1024) //bytes waiting for the next batch; events beyond that are dropped(and counted) instead of growing without bound
+#define TELEMETRYMAXCLIENTS 8
+
+struct PStateSnapshot;
+
+#ifdef AMDMSRT_BOOTAPPLY
+//the boot-time apply binary has no socket to publish on: no telemetry.cpp, and every event compiles away
+inline bool TelemetryActive() { return false; }
+inline void TelemetryRequest(const int, const int, const int64_t) {}
+inline void TelemetryTransition(const int, const int, const int, const int64_t) {}
+inline void TelemetryTemperature(const double) {}
+inline void TelemetryApply(const int, const int, const int, const int, const int, const bool) {}
+inline void TelemetryBoost(const bool, const int) {}
+inline void TelemetrySnapshot(const PStateSnapshot&) {}
+#else
+extern std::atomic<int> telemetryclients;
+
+inline bool TelemetryActive() {
+  return telemetryclients.load(std::memory_order_relaxed) > 0;
+}
+
+//starts listening on that socket path(replacing a stale one) and the thread that accepts clients and sends the batches; stopped at exit
+bool TelemetryOpen(const char* path);
+void TelemetryClose();
+
+void TelemetryRequest(const int cpu, const int pstate, const int64_t latencyns);
+void TelemetryTransition(const int cpu, const int from, const int to, const int64_t ns);
+void TelemetryTemperature(const double celsius);
+void TelemetryApply(const int cores, const int differing, const int written, const int switched, const int errors, const bool rolledback);
+void TelemetryBoost(const bool enabled, const int errors);
+void TelemetrySnapshot(const PStateSnapshot& snap);
+#endif
@@ -0,0 +1,105 @@
+#include "thermal.h"
+#include "mumu.h"
+
+#include <stdio.h>
+#include <stdlib.h> //strtol
+#include <string.h>
+#include <unistd.h> //pread
+#include <fcntl.h>
+#include <dirent.h>
+
+#define K10TEMPNAME "k10temp"
+#define PCIMISCCONFIG "/sys/bus/pci/devices/0000:00:18.3/config" //D18F3: Miscellaneous Control
+#define REPORTEDTEMPERATURECONTROL 0xa4 //D18F3xA4, CurTmp is bits 31:21 in 0.125 degC steps
+
+static int thermalfd=-1;
+static bool thermalispci=false;
+static char thermalpath[512]="\0";
+
+static bool OpenK10temp() {
+  DIR* dir=opendir("/sys/class/hwmon");
+  if (NULL == dir) {
+    return false;
+  }
+  struct dirent* entry;
+  while (NULL != (entry=readdir(dir))) {
+    if ('.' == entry->d_name[0]) {
+      continue;
+    }
+    char path[512]="\0";
+    snprintf(path, sizeof(path), "/sys/class/hwmon/%s/name", entry->d_name);
+    FILE* f=fopen(path, "r");
+    if (NULL == f) {
+      continue;
+    }
+    char name[64]="\0";
+    const bool ok=(NULL != fgets(name, sizeof(name), f));
+    fclose(f);
+    if (ok && (0 == strncmp(name, K10TEMPNAME, strlen(K10TEMPNAME)))) {
+      snprintf(thermalpath, sizeof(thermalpath), "/sys/class/hwmon/%s/temp1_input", entry->d_name);
+      thermalfd=open(thermalpath, O_RDONLY | O_CLOEXEC);
+      if (-1 != thermalfd) {
+        break;
+      }
+    }
+  }
+  closedir(dir);
+  return (-1 != thermalfd);
+}
+
+static bool (*thermaloverride)(double& degC)=NULL;
+
+void SetTemperatureSource(bool (*read)(double& degC), const char* name) {
+  thermaloverride=read;
+  if (-1 != thermalfd) {
+    close(thermalfd);//thermalpath is about to name something else
+    thermalfd=-1;
+  }
+  snprintf(thermalpath, sizeof(thermalpath), "%s", (NULL == name ? "" : name));
+}
+
+bool ThermalOpen() {
+  if (NULL != thermaloverride) {
+    return true;
+  }
+  if (-1 != thermalfd) {
+    return true;
+  }
+  if (OpenK10temp()) {
+    thermalispci=false;
+    return true;
+  }
+  snprintf(thermalpath, sizeof(thermalpath), "%s", PCIMISCCONFIG);
+  thermalfd=open(thermalpath, O_RDONLY | O_CLOEXEC);
+  thermalispci=(-1 != thermalfd);
+  return thermalispci;
+}
+
+bool ReadTemperature(double& degC) {
+  if (NULL != thermaloverride) {
+    return thermaloverride(degC);
+  }
+  if (!ThermalOpen()) {
+    return false;
+  }
+  if (thermalispci) {
+    uint32_t reg=0;
+    if (sizeof(reg) != pread(thermalfd, &reg, sizeof(reg), REPORTEDTEMPERATURECONTROL)) {
+      return false;
+    }
+    degC=GetBits(reg, 21, 11) * 0.125;
+    return true;
+  }
+  char buf[32];
+  const ssize_t len=pread(thermalfd, buf, sizeof(buf)-1, 0);//sysfs attributes can be re-read from offset 0 without reopening
+  if (len <= 0) {
+    return false;
+  }
+  buf[len]='\0';
+  degC=strtol(buf, NULL, 10) / 1000.0;//millidegrees
+  return true;
+}
+
+const char* ThermalSource() {
+  return thermalpath;
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+//core temperature, from k10temp's hwmon if that driver is loaded, else straight from the family 12h "Reported Temperature Control" register(D18F3xA4) via pci config space
+//the file is opened once and kept, every ReadTemperature() is then a single pread
+
+bool ThermalOpen();//false if neither source is available
+//replaces both sources, eg. with the simulated cpu's temperature(see simcpu.h); NULL goes back to them, found again on the next read
+void SetTemperatureSource(bool (*read)(double& degC), const char* name);
+bool ReadTemperature(double& degC);
+const char* ThermalSource();//for display, eg. "/sys/class/hwmon/hwmon0/temp1_input"
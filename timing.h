@@ -0,0 +1,10 @@
+#pragma once
+
+#include <inttypes.h>
+#include <time.h>
+
+inline int64_t NowNs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}